@@ -0,0 +1,145 @@
+#!/bin/bash
+# Measure the speed of the MIPS simulator on a set of CPU-bound programs.
+#
+# Run through `make bench` (or `make bench-baseline`) in the parent
+# directory, which builds the kernels and the programs first.
+#
+# Every program in `BENCH_PROGRAMS` is run `BENCH_REPS` times under every
+# kernel in `BENCH_KERNELS`, with the extra options in `BENCH_FLAGS` (for
+# example `-bb` or `-jit`).  For each pair, the fastest host wall time is
+# written to `bench/results.csv`, with the simulated instructions (user
+# ticks, one per instruction), the resulting MIPS and the total ticks.
+#
+# Then the results are compared with `bench/baseline.csv`, if there is one:
+# the ratio of wall times is printed for every program, and any change in
+# instructions or ticks is flagged, since an interpreter change should not
+# alter what is simulated.  Programs are matched by kernel and name only, so
+# a baseline saved without flags also measures what `-bb` or `-jit` gain.
+# With `-save`, the results become the new baseline instead.  Wall times
+# only compare on the same host, so the baseline is not meant to be shared.
+
+set -e
+
+SAVE=$1
+cd "$(dirname "$0")/.."
+CODE=$(pwd)
+
+KERNELS=${BENCH_KERNELS:-"userprog vmem"}
+PROGRAMS=${BENCH_PROGRAMS:-"matmult10 matmult matmult30 sort bench_branch
+                            bench_memory bench_syscall"}
+FLAGS=${BENCH_FLAGS:-}
+REPS=${BENCH_REPS:-3}
+RESULTS=$CODE/bench/results.csv
+BASELINE=$CODE/bench/baseline.csv
+
+# Run one program, and print its wall time in seconds, user ticks and total
+# ticks.
+#
+# The kernel waits for console input as long as its input stays open, so it
+# is given an empty one, and halts once the program is done.
+run_once()
+{
+    local kernel=$1 program=$2 start end output
+
+    start=$(date +%s%N)
+    output=$(cd "$CODE/$kernel" && ./nachos $FLAGS -x "$program" \
+                                            </dev/null 2>&1) || true
+    end=$(date +%s%N)
+
+    echo "$output" | awk -v ns=$((end - start)) '
+        /^Ticks: total/ {
+            gsub(",", "");
+            for (i = 1; i < NF; i++) {
+                if ($i == "total") total = $(i + 1);
+                if ($i == "user")  user  = $(i + 1);
+            }
+        }
+        END {
+            if (total == "")
+                exit 1;
+            printf "%.4f %s %s\n", ns / 1e9, user, total;
+        }'
+}
+
+for kernel in $KERNELS; do
+    if [ ! -x "$kernel/nachos" ]; then
+        echo "bench: $kernel/nachos is not built" >&2
+        exit 1
+    fi
+done
+
+echo "kernel,program,flags,wall,instructions,mips,ticks" > "$RESULTS"
+for kernel in $KERNELS; do
+    for name in $PROGRAMS; do
+        case $name in
+            /*) program=$name ;;
+            *)  program=$CODE/userland/$name ;;
+        esac
+        if [ ! -f "$program" ]; then
+            echo "bench: $program is not built" >&2
+            exit 1
+        fi
+
+        best=
+        for rep in $(seq "$REPS"); do
+            if ! result=$(run_once "$kernel" "$program"); then
+                echo "bench: $kernel did not finish $(basename "$program")" >&2
+                exit 1
+            fi
+            set -- $result
+            if [ -z "$best" ] || awk "BEGIN { exit !($1 < $best) }"; then
+                best=$1 user=$2 total=$3
+            fi
+        done
+
+        awk -v k="$kernel" -v p="$(basename "$program")" -v f="$FLAGS" \
+            -v w="$best" -v u="$user" -v t="$total" 'BEGIN {
+                printf "%s,%s,%s,%s,%s,%.2f,%s\n",
+                       k, p, f, w, u, (w > 0 ? u / w / 1e6 : 0), t
+            }' >> "$RESULTS"
+    done
+done
+
+awk -F, '{ printf "%-10s %-16s %-8s %10s %12s %8s %12s\n",
+                   $1, $2, $3, $4, $5, $6, $7 }' "$RESULTS"
+
+if [ "$SAVE" = "-save" ]; then
+    cp "$RESULTS" "$BASELINE"
+    echo
+    echo "Saved as the baseline in bench/baseline.csv."
+    exit 0
+fi
+
+if [ ! -f "$BASELINE" ]; then
+    echo
+    echo "No baseline to compare with; run \`make bench-baseline\` first."
+    exit 0
+fi
+
+echo
+echo "Compared with bench/baseline.csv (wall time ratio, below 1 is faster):"
+awk -F, '
+    FNR == 1 { next }
+    NR == FNR { wall[$1 "," $2] = $4;
+                instr[$1 "," $2] = $5;
+                ticks[$1 "," $2] = $7;
+                next }
+    {
+        key = $1 "," $2;
+        if (!(key in wall)) {
+            printf "  %-10s %-16s %s\n", $1, $2, "not in the baseline";
+            next;
+        }
+        note = "";
+        if ($5 != instr[key] || $7 != ticks[key])
+            note = sprintf("  instructions %s -> %s, ticks %s -> %s",
+                           instr[key], $5, ticks[key], $7);
+        ratio = wall[key] > 0 ? $4 / wall[key] : 0;
+        printf "  %-10s %-16s %.3f%s\n", $1, $2, ratio, note;
+        sum += log(ratio > 0 ? ratio : 1);
+        n++;
+    }
+    END {
+        if (n > 0)
+            printf "  %-27s %.3f\n", "geometric mean", exp(sum / n);
+    }' "$BASELINE" "$RESULTS"
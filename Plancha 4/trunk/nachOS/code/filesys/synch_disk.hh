@@ -43,6 +43,12 @@ public:
     /// current disk operation is complete.
     void RequestDone();
 
+#ifdef USER_PROGRAM
+    /// Save or restore the disk image (see `Disk::Save`).
+    void Save(Snapshot *snapshot) const;
+    void Restore(Snapshot *snapshot);
+#endif
+
 private:
     Disk *disk;  ///< Raw disk device.
     Semaphore *semaphore;  ///< To synchronize requesting thread with the
@@ -0,0 +1,228 @@
+/// Data structures to queue objects without allocating memory.
+///
+/// `List` allocates a `ListElement` for every item it holds.  An intrusive
+/// list instead links the items themselves, through a `ListLink` member
+/// that each of them has: putting an item on a list or taking it off never
+/// allocates, and an item can be removed in constant time from whatever
+/// list it is on, without searching for it.
+///
+/// The price is that an item can only be on one list per `ListLink` it
+/// has.  For instance, a `Thread` has a single link, shared by the ready
+/// lists of the scheduler and the wait queues of semaphores, locks and
+/// condition variables, since a thread is never ready and waiting at once.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_LIB_INTRUSIVELIST__HH
+#define NACHOS_LIB_INTRUSIVELIST__HH
+
+
+#include "utility.hh"
+
+
+/// The following class defines the links that an object embeds in order to
+/// be put on an `IntrusiveList`.
+///
+/// A link that is not on a list has `NULL` neighbours.
+template <class Item>
+class ListLink {
+public:
+
+    /// Initialize a link that is not on any list.
+    ListLink();
+
+    /// Is the item on some list?
+    bool IsLinked() const;
+
+    /// Take the item off the list it is on, whichever that is.
+    void Unlink();
+
+private:
+
+    template <class I, ListLink<I> I::*L> friend class IntrusiveList;
+
+    ListLink *prev;  ///< Previous link, or the head of the list.
+    ListLink *next;  ///< Next link, or the head of the list.
+    Item *owner;     ///< The item this link is embedded in.
+};
+
+/// The following class defines a doubly linked, circular list of items of
+/// type `Item`, linked through their `LINK` member.
+///
+/// The list does not own its items: they are neither allocated nor deleted
+/// here.
+template <class Item, ListLink<Item> Item::*LINK>
+class IntrusiveList {
+public:
+
+    /// Initialize the list, empty to start with.
+    IntrusiveList();
+
+    /// Take every item off the list.
+    ~IntrusiveList();
+
+    /// Put `item` at the beginning of the list.  It must not be on any list
+    /// through the same link.
+    void Prepend(Item *item);
+
+    /// Put `item` at the end of the list.  It must not be on any list
+    /// through the same link.
+    void Append(Item *item);
+
+    /// Take the first item off the list; `NULL` if the list is empty.
+    Item *Pop();
+
+    /// Take `item` off the list.  It must be on it.
+    void Remove(Item *item);
+
+    /// Apply `func` to every item on the list, from first to last.
+    void Apply(void (*func)(Item *)) const;
+
+    /// Is the list empty?
+    bool IsEmpty() const;
+
+    /// Look at the first item, without removing it; `NULL` if the list is
+    /// empty.
+    Item *Head() const;
+
+    /// Look at the item after `item`, which must be on the list; `NULL` if
+    /// it is the last one.
+    Item *Next(const Item *item) const;
+
+private:
+
+    /// Links of the first and last items; the list is empty when it links
+    /// to itself.
+    ListLink<Item> head;
+
+    /// Link `item` right after `prev`.
+    void Insert(Item *item, ListLink<Item> *prev);
+};
+
+template <class Item>
+ListLink<Item>::ListLink()
+{
+    prev  = NULL;
+    next  = NULL;
+    owner = NULL;
+}
+
+template <class Item>
+bool
+ListLink<Item>::IsLinked() const
+{
+    return next != NULL;
+}
+
+template <class Item>
+void
+ListLink<Item>::Unlink()
+{
+    ASSERT(IsLinked());
+
+    prev->next = next;
+    next->prev = prev;
+    prev = next = NULL;
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+IntrusiveList<Item, LINK>::IntrusiveList()
+{
+    head.prev = head.next = &head;
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+IntrusiveList<Item, LINK>::~IntrusiveList()
+{
+    while (!IsEmpty())
+        Pop();
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+void
+IntrusiveList<Item, LINK>::Insert(Item *item, ListLink<Item> *prev)
+{
+    ASSERT(item != NULL);
+
+    ListLink<Item> *link = &(item->*LINK);
+    ASSERT(!link->IsLinked());
+
+    link->owner = item;
+    link->prev  = prev;
+    link->next  = prev->next;
+    prev->next->prev = link;
+    prev->next = link;
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+void
+IntrusiveList<Item, LINK>::Prepend(Item *item)
+{
+    Insert(item, &head);
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+void
+IntrusiveList<Item, LINK>::Append(Item *item)
+{
+    Insert(item, head.prev);
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+Item *
+IntrusiveList<Item, LINK>::Pop()
+{
+    if (IsEmpty())
+        return NULL;
+
+    ListLink<Item> *link = head.next;
+    link->Unlink();
+    return link->owner;
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+void
+IntrusiveList<Item, LINK>::Remove(Item *item)
+{
+    ASSERT(item != NULL);
+    (item->*LINK).Unlink();
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+void
+IntrusiveList<Item, LINK>::Apply(void (*func)(Item *)) const
+{
+    ASSERT(func != NULL);
+    for (ListLink<Item> *link = head.next; link != &head; link = link->next)
+        func(link->owner);
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+bool
+IntrusiveList<Item, LINK>::IsEmpty() const
+{
+    return head.next == &head;
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+Item *
+IntrusiveList<Item, LINK>::Head() const
+{
+    return IsEmpty() ? NULL : head.next->owner;
+}
+
+template <class Item, ListLink<Item> Item::*LINK>
+Item *
+IntrusiveList<Item, LINK>::Next(const Item *item) const
+{
+    ASSERT(item != NULL);
+
+    const ListLink<Item> *link = &(item->*LINK);
+    ASSERT(link->IsLinked());
+    return link->next == &head ? NULL : link->next->owner;
+}
+
+
+#endif
@@ -77,6 +77,9 @@ public:
     /// Remove first item from list.
     Item SortedPop(int *keyPtr);
 
+    /// Look at the first item, without removing it.
+    Item Head() const;
+
 private:
 
     typedef ListElement<Item> ListNode;
@@ -317,4 +320,16 @@ List<Item>::SortedPop(int *keyPtr)
 }
 
 
+/// Return the first item on the list (the one with the smallest key, for a
+/// sorted list), `NULL` if the list is empty.  The list is not modified.
+template <class Item>
+Item
+List<Item>::Head() const
+{
+    if (IsEmpty())
+        return Item();
+    return first->item;
+}
+
+
 #endif
@@ -15,8 +15,9 @@
 #include <stdarg.h>
 
 
-/// Controls which `DEBUG` messages are printed.
-static const char *enableFlags = NULL;
+/// Controls which `DEBUG` messages are printed: bit `c % 32` of word
+/// `c / 32` stands for flag character `c`.
+unsigned debugFlags[256 / 32];
 
 /// Initialize so that only `DEBUG` messages with a flag in `flagList` will
 /// be printed.
@@ -28,48 +29,31 @@ static const char *enableFlags = NULL;
 void
 DebugInit(const char *flagList)
 {
-    enableFlags = flagList;
-}
-
-/// Return true if `DEBUG` messages with `flag` are to be printed.
-bool
-DebugIsEnabled(char flag)
-{
-    if (enableFlags != NULL)
-        return strchr(enableFlags, flag) != 0
-               || strchr(enableFlags, '+') != 0;
-    else
-        return false;
-}
-
-/// Print a debug message, if `flag` is enabled.  Like `printf`, only with an
-/// extra argument on the front.
-void
-DEBUG(char flag, const char *format, ...)
-{
-    ASSERT(format != NULL);
-
-    if (!DebugIsEnabled(flag))
+    for (unsigned i = 0; i < 256 / 32; i++)
+        debugFlags[i] = 0;
+    if (flagList == NULL)
         return;
 
-    fprintf(stderr, "[%c] ", flag);
-
-    va_list ap;
-    // You will get an unused variable message here -- ignore it.
-    va_start(ap, format);
-    vfprintf(stderr, format, ap);
-    va_end(ap);
-
-    fflush(stderr);
+    for (const char *f = flagList; *f != '\0'; f++) {
+        unsigned char c = *f;
+        debugFlags[c / 32] |= 1U << c % 32;
+    }
+    if (strchr(flagList, '+') != NULL)
+        for (unsigned i = 0; i < 256 / 32; i++)
+            debugFlags[i] = ~0U;
 }
 
+/// Print a debug message.  Like `printf`, only with an extra argument on
+/// the front.
+///
+/// The caller has already checked that `flag` is enabled.
 void
-DEBUG_CONT(char flag, const char *format, ...)
+DebugPrint(char flag, bool prefix, const char *format, ...)
 {
     ASSERT(format != NULL);
 
-    if (!DebugIsEnabled(flag))
-        return;
+    if (prefix)
+        fprintf(stderr, "[%c] ", flag);
 
     va_list ap;
     // You will get an unused variable message here -- ignore it.
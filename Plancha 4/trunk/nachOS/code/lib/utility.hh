@@ -14,6 +14,8 @@
 /// * `f` -- file system (requires *FILESYS*).
 /// * `a` -- address spaces (requires *USER_PROGRAM*).
 /// * `n` -- network emulation (requires *NETWORK*).
+/// * `k` -- basic blocks built by the threaded-code interpreter, and their
+///   translations to host code (requires *USER_PROGRAM*).
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2018 Docentes de la Universidad Nacional de Rosario.
@@ -71,20 +73,66 @@ typedef void (*VoidNoArgFunctionPtr)();
 #include "machine/system_dep.hh"
 
 /// Interface to debugging routines.
+///
+/// `DEBUG` and `DEBUG_CONT` are macros: the flag is tested inline, and the
+/// message arguments are only evaluated when it is enabled, so disabled
+/// messages cost a single bit test even on the simulator's hot paths.
+/// Building with `-DNO_DEBUG` (see `Makefile.common`) removes them
+/// altogether; `-d` is still accepted then, but has no effect.
 
 /// Enable printing debug messages.
 extern void DebugInit(const char *flags);
 
+/// Print a debug message, prefixed by its flag if `prefix` is true.  Use
+/// `DEBUG`/`DEBUG_CONT` instead, which check the flag first.
+extern void DebugPrint(char flag, bool prefix, const char *format, ...)
+  __attribute__((format(printf, 3, 4)));
+
+#ifdef NO_DEBUG
+
+inline bool
+DebugIsEnabled(char flag)
+{
+    return false;
+}
+
+// Still compiled, so that messages keep type checking and their arguments
+// do not look unused, but never run.
+#define DEBUG(flag, ...)                                                  \
+    do { if (false) DebugPrint(flag, true, __VA_ARGS__); } while (0)
+#define DEBUG_CONT(flag, ...)                                             \
+    do { if (false) DebugPrint(flag, false, __VA_ARGS__); } while (0)
+
+#else
+
+/// One bit per flag character, set by `DebugInit`.
+extern unsigned debugFlags[256 / 32];
+
 /// Is this debug flag enabled?
-extern bool DebugIsEnabled(char flag);
+inline bool
+DebugIsEnabled(char flag)
+{
+    unsigned char c = flag;
+    return debugFlags[c / 32] >> c % 32 & 1;
+}
 
 /// Print debug message if `flag` is enabled, along with a flag prefix.
-extern void DEBUG(char flag, const char *format, ...);
+#define DEBUG(flag, ...)                                                  \
+    do {                                                                  \
+        if (DebugIsEnabled(flag))                                         \
+            DebugPrint(flag, true, __VA_ARGS__);                          \
+    } while (0)
 
 /// Same as `DEBUG` but avoid printing flag prefix.
 ///
 /// Useful for splitting a call for a `DEBUG` line into multiple calls.
-extern void DEBUG_CONT(char flag, const char *format, ...);
+#define DEBUG_CONT(flag, ...)                                             \
+    do {                                                                  \
+        if (DebugIsEnabled(flag))                                         \
+            DebugPrint(flag, false, __VA_ARGS__);                         \
+    } while (0)
+
+#endif
 
 /// If `condition` is false, print a message and dump core.
 ///
@@ -0,0 +1,68 @@
+/// Data structures for the threaded-code tier of the MIPS simulator.
+///
+/// A basic block is a straight-line run of decoded instructions, starting at
+/// some physical address, where every instruction has already been bound to
+/// the piece of `Machine::RunBlock` that executes it.  Running a block is
+/// then just a matter of jumping from one handler to the next, with no
+/// fetch, decode or `switch` in between.
+///
+/// DO NOT CHANGE -- part of the machine emulation
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_MACHINE_BASICBLOCK__HH
+#define NACHOS_MACHINE_BASICBLOCK__HH
+
+
+#include "instruction.hh"
+#include "machine.hh"
+
+
+/// Blocks never cross a boundary of `SECTOR_SIZE` bytes, and therefore
+/// never a page boundary either, whatever the page size: a single
+/// translation covers every instruction in them.
+const unsigned MAX_BLOCK_LENGTH = SECTOR_SIZE / 4;
+
+/// Host code generated for the beginning of a block (see `jit.cc`).
+///
+/// It runs instructions straight from the start of the block, and returns
+/// how many of them it retired; it stops early, without touching the
+/// machine state, at an instruction that would trap.
+typedef unsigned (*NativeCode)(int *registers, Machine *machine);
+
+/// One instruction of a block, together with its handler.
+struct BlockOp {
+    const void *handler;  ///< Address of a label inside `RunBlock`, for
+                          ///< dispatching with a computed `goto`.
+    Instruction instr;
+};
+
+/// A block ends right after the delay slot of its first branch or jump,
+/// after a system call or illegal instruction, or at the end of the page,
+/// whichever comes first.
+struct BasicBlock {
+    unsigned generation;  ///< Code generation of the frame when the block
+                          ///< was built; the block is stale once it differs.
+    unsigned length;      ///< Number of valid entries in `ops`.
+    BlockOp ops[MAX_BLOCK_LENGTH];
+
+    unsigned executions;     ///< Times the block was entered; it is
+                             ///< translated when this reaches the JIT
+                             ///< threshold.
+    NativeCode native;       ///< Translated code, `NULL` if none.
+    unsigned nativeLength;   ///< Instructions covered by `native`.
+    unsigned nativeAddress;  ///< Virtual address the block was translated
+                             ///< for (the code embeds it).
+    bool nativeBranch;       ///< Whether `native` ends with a conditional
+                             ///< branch and its delay slot.
+
+    /// Runs of `native` to the end, and branches taken in them, not yet
+    /// added to the instruction mix in `stats` (see `CountNativeRuns`).
+    unsigned long long nativeRuns, nativeTaken;
+};
+
+
+#endif
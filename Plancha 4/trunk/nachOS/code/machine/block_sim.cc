@@ -0,0 +1,378 @@
+/// Threaded-code interpreter tier for the MIPS simulator.
+///
+/// Instead of fetching, decoding and dispatching every instruction through
+/// the `switch` in `ExecInstruction`, straight-line runs of code are
+/// translated once into a `BasicBlock` of handler addresses, and then run by
+/// jumping directly from one handler to the next (GCC's “labels as values”).
+/// The most frequent instructions have their own handler; anything else
+/// falls back to `ExecInstruction`.
+///
+/// The simulated machine cannot tell the difference: every instruction is
+/// still followed by `Interrupt::OneTick`, every fetch counts as a TLB hit,
+/// delayed loads are applied exactly as in `ExecInstruction`, and an
+/// instruction that raises an exception is restarted from scratch by going
+/// back to `Run`.
+///
+/// DO NOT CHANGE -- part of the machine emulation
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "basic_block.hh"
+#include "threads/system.hh"
+
+
+/// Return true if `opCode` is a branch or a jump, that is, if the next
+/// instruction is a delay slot.
+static inline bool
+IsControlTransfer(unsigned opCode)
+{
+    switch (opCode) {
+        case OP_BEQ:  case OP_BNE:  case OP_BGEZ: case OP_BGEZAL:
+        case OP_BGTZ: case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL:
+        case OP_J:    case OP_JAL:  case OP_JALR: case OP_JR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// Return true if execution cannot be expected to fall through `opCode`
+/// into the next word.
+static inline bool
+IsTrap(unsigned opCode)
+{
+    return opCode == OP_SYSCALL || opCode == OP_RES || opCode == OP_UNIMP;
+}
+
+/// Translate the code starting at `physicalAddress` into a block, reusing
+/// the storage of a stale block already there, if any.
+///
+/// * `handlers` maps every opcode to its label inside `RunBlock`.
+BasicBlock *
+Machine::BuildBlock(unsigned physicalAddress, const void *const *handlers)
+{
+    ASSERT(physicalAddress % 4 == 0);
+    ASSERT(handlers != NULL);
+
+    unsigned    slot = physicalAddress / 4;
+    unsigned    end = (slot / MAX_BLOCK_LENGTH + 1) * MAX_BLOCK_LENGTH;
+    BasicBlock *block = blocks[slot];
+    bool        inDelaySlot = false;
+
+    if (block == NULL)
+        block = blocks[slot] = new BasicBlock;
+    else if (block->native != NULL)
+        CountNativeRuns(block);
+    block->generation = codeGeneration[physicalAddress >> pageShift];
+    block->length = 0;
+    block->executions = 0;
+    block->native = NULL;
+    block->nativeRuns = block->nativeTaken = 0;
+
+    for (unsigned i = slot; i < end; i++) {
+        BlockOp *op = &block->ops[block->length++];
+        op->instr = *DecodedAt(i * 4);
+        op->handler = handlers[op->instr.opCode];
+        if (inDelaySlot || IsTrap(op->instr.opCode))
+            break;
+        inDelaySlot = IsControlTransfer(op->instr.opCode);
+    }
+    DEBUG('k', "Built block of %u instructions at physical address 0x%X\n",
+          block->length, physicalAddress);
+    return block;
+}
+
+/// Run the block of code at the current PC, for as long as execution stays
+/// inside it.
+///
+/// The first instruction is fetched by `Translate` like any other.  Once in
+/// the block, the translation entry that was found is only re-checked after
+/// every instruction: if anything could have changed the mapping or the
+/// code (an exception, a context switch inside `OneTick`, a store into the
+/// page), the check fails and we return, so that `Run` starts over with a
+/// real fetch.
+///
+/// Blocks that have been translated to host code run that instead, as long
+/// as no interrupt can fall due before the translated part is over, so
+/// that a single `AdvanceTicks` at the end is as good as a `OneTick` after
+/// every instruction.
+void
+Machine::RunBlock()
+{
+    static const void *handlers[MAX_OPCODE + 1];
+
+    if (handlers[0] == NULL) {
+        for (unsigned i = 0; i <= MAX_OPCODE; i++)
+            handlers[i] = &&generic;
+        handlers[OP_ADDIU] = &&addiu;
+        handlers[OP_ADDU]  = &&addu;
+        handlers[OP_AND]   = &&and_;
+        handlers[OP_ANDI]  = &&andi;
+        handlers[OP_BEQ]   = &&beq;
+        handlers[OP_BGEZ]  = &&bgez;
+        handlers[OP_BGTZ]  = &&bgtz;
+        handlers[OP_BLEZ]  = &&blez;
+        handlers[OP_BLTZ]  = &&bltz;
+        handlers[OP_BNE]   = &&bne;
+        handlers[OP_J]     = &&j;
+        handlers[OP_JAL]   = &&jal;
+        handlers[OP_JR]    = &&jr;
+        handlers[OP_LUI]   = &&lui;
+        handlers[OP_LW]    = &&lw;
+        handlers[OP_MFHI]  = &&mfhi;
+        handlers[OP_MFLO]  = &&mflo;
+        handlers[OP_OR]    = &&or_;
+        handlers[OP_ORI]   = &&ori;
+        handlers[OP_SLL]   = &&sll;
+        handlers[OP_SLT]   = &&slt;
+        handlers[OP_SLTI]  = &&slti;
+        handlers[OP_SRA]   = &&sra;
+        handlers[OP_SRL]   = &&srl;
+        handlers[OP_SUBU]  = &&subu;
+        handlers[OP_SW]    = &&sw;
+        handlers[OP_XOR]   = &&xor_;
+    }
+
+    ExceptionType      exception;
+    unsigned           physicalAddress;
+    unsigned           pc = registers[PC_REG];
+    unsigned           vpn, frame, i;
+    TranslationEntry  *entry;
+    TranslationEntry  *table = pageTable;
+    BasicBlock        *block;
+    const Instruction *instr;
+    int                nextLoadReg, nextLoadValue, pcAfter, value;
+    unsigned           addr, retired, loadReg;
+
+    exception = Translate(pc, &physicalAddress, 4, false);
+    if (exception != NO_EXCEPTION) {
+        RaiseException(exception, pc);
+        return;
+    }
+
+    // Find the entry `Translate` has just used, to re-check it later.
+    vpn = pc >> pageShift;
+    frame = physicalAddress >> pageShift;
+    if (tlb == NULL)
+        entry = &pageTable[vpn];
+    else
+        for (entry = tlb; !entry->valid || entry->virtualPage != vpn; entry++)
+            ;
+
+    block = blocks[physicalAddress / 4];
+    if (block == NULL || block->generation != codeGeneration[frame])
+        block = BuildBlock(physicalAddress, handlers);
+    i = 0;
+
+    if (jitThreshold != 0 && ++block->executions == jitThreshold)
+        CompileBlock(block, pc);
+    if (block->native != NULL && block->nativeAddress == pc
+          && (unsigned) registers[NEXT_PC_REG] == pc + 4
+          && interrupt->TicksUntilDue() >= block->nativeLength) {
+        jitFrame = frame;
+        loadReg = registers[LOAD_REG];
+        retired = block->native(registers, this);
+        if (retired == block->nativeLength && loadReg == 0) {
+            // The common case: only tally the run, for `CountNativeRuns`.
+            block->nativeRuns++;
+            if (block->nativeBranch && (unsigned) registers[PC_REG]
+                                         != pc + 4 * block->nativeLength)
+                block->nativeTaken++;
+        } else if (retired > 0)
+            CountNative(block, retired, loadReg);
+        if (retired > 0) {
+            // The fetch of the first instruction was already counted.
+#ifdef USE_TLB
+            if (tlb != NULL)
+                stats->numHit += retired - 1;
+#endif
+            interrupt->AdvanceTicks(retired);
+            return;
+        }
+        // The very first instruction would trap: let the handlers below
+        // run it, without fetching it again.
+    }
+
+dispatch:
+    instr = &block->ops[i].instr;
+    nextLoadReg = 0;
+    nextLoadValue = 0;
+    pcAfter = registers[NEXT_PC_REG] + 4;
+    goto *block->ops[i].handler;
+
+    // Handlers.  Each one either completes its instruction and goes to
+    // `retire`, or raises an exception and goes straight to `tick`, leaving
+    // the PC where it was so the instruction is restarted.  They must do
+    // exactly what the corresponding case of `ExecInstruction` does.
+
+addiu:
+    registers[instr->rt] = registers[instr->rs] + instr->extra;
+    goto retire;
+
+addu:
+    registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
+    goto retire;
+
+and_:
+    registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
+    goto retire;
+
+andi:
+    registers[instr->rt] = registers[instr->rs] & (instr->extra & 0xFFFF);
+    goto retire;
+
+beq:
+    if (registers[instr->rs] == registers[instr->rt])
+        pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
+    goto retire;
+
+bgez:
+    if (!(registers[instr->rs] & SIGN_BIT))
+        pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
+    goto retire;
+
+bgtz:
+    if (registers[instr->rs] > 0)
+        pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
+    goto retire;
+
+blez:
+    if (registers[instr->rs] <= 0)
+        pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
+    goto retire;
+
+bltz:
+    if (registers[instr->rs] & SIGN_BIT)
+        pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
+    goto retire;
+
+bne:
+    if (registers[instr->rs] != registers[instr->rt])
+        pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
+    goto retire;
+
+jal:
+    registers[R31] = registers[NEXT_PC_REG] + 4;
+j:
+    pcAfter = (pcAfter & 0xF0000000) | IndexToAddr(instr->extra);
+    goto retire;
+
+jr:
+    pcAfter = registers[instr->rs];
+    goto retire;
+
+lui:
+    registers[instr->rt] = instr->extra << 16;
+    goto retire;
+
+lw:
+    addr = registers[instr->rs] + instr->extra;
+    if (addr & 0x3) {
+        RaiseException(ADDRESS_ERROR_EXCEPTION, addr);
+        goto tick;
+    }
+    if (!ReadMem(addr, 4, &value))
+        goto tick;
+    nextLoadReg = instr->rt;
+    nextLoadValue = value;
+    goto retire;
+
+mfhi:
+    registers[instr->rd] = registers[HI_REG];
+    goto retire;
+
+mflo:
+    registers[instr->rd] = registers[LO_REG];
+    goto retire;
+
+or_:
+    registers[instr->rd] = registers[instr->rs] | registers[instr->rt];
+    goto retire;
+
+ori:
+    registers[instr->rt] = registers[instr->rs] | (instr->extra & 0xFFFF);
+    goto retire;
+
+sll:
+    registers[instr->rd] = registers[instr->rt] << instr->extra;
+    goto retire;
+
+slt:
+    registers[instr->rd] = registers[instr->rs] < registers[instr->rt];
+    goto retire;
+
+slti:
+    registers[instr->rt] = registers[instr->rs] < instr->extra;
+    goto retire;
+
+sra:
+srl:
+    // `ExecInstruction` shifts a signed temporary for `srl` too.
+    registers[instr->rd] = registers[instr->rt] >> instr->extra;
+    goto retire;
+
+subu:
+    registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
+    goto retire;
+
+sw:
+    if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra),
+                  4, registers[instr->rt]))
+        goto tick;
+    goto retire;
+
+xor_:
+    registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
+    goto retire;
+
+generic:
+    ExecInstruction(instr);
+    goto tick;
+
+retire:
+    // Same as `CountInstruction`, written out because it is done for every
+    // instruction.
+    stats->numInstructions[instr->opCode]++;
+    if (pcAfter != registers[NEXT_PC_REG] + 4
+          && instr->opCode >= OP_BEQ && instr->opCode <= OP_BNE)
+        stats->numBranchesTaken++;
+    if (instr->sources >> registers[LOAD_REG] & 1)
+        stats->numLoadUses++;
+
+    // Same as `DelayedLoad` followed by advancing the program counters, at
+    // the end of `ExecInstruction`.
+    registers[registers[LOAD_REG]] = registers[LOAD_VALUE_REG];
+    registers[LOAD_REG] = nextLoadReg;
+    registers[LOAD_VALUE_REG] = nextLoadValue;
+    registers[0] = 0;
+    registers[PREV_PC_REG] = registers[PC_REG];
+    registers[PC_REG] = registers[NEXT_PC_REG];
+    registers[NEXT_PC_REG] = pcAfter;
+
+tick:
+    interrupt->OneTick();
+
+    // Go on with the next instruction only if a fetch would find it in this
+    // very block: the PC just moved to it, the code was not modified, and
+    // the page is still mapped through the same entry.
+    i++;
+    if (i == block->length
+          || block->generation != codeGeneration[frame]
+          || (unsigned) registers[PC_REG] != pc + i * 4
+          || pageTable != table
+          || !entry->valid || entry->physicalPage != frame
+          || (tlb != NULL && entry->virtualPage != vpn))
+        return;
+
+    // The rest of what `Translate` does for an instruction fetch.
+#ifdef USE_TLB
+    if (tlb != NULL)
+        stats->numHit++;
+#endif
+    entry->use = true;
+    goto dispatch;
+}
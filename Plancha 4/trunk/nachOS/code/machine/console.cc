@@ -6,6 +6,9 @@
 /// simulated delay), to signal that a byte has arrived and/or that a written
 /// byte has departed.
 ///
+/// The keyboard file is not polled: it is watched (see `WatchFile`), and the
+/// read interrupt is only scheduled once the host has input for it.
+///
 /// DO NOT CHANGE -- part of the machine emulation
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
@@ -20,6 +23,14 @@
 
 /// Dummy functions because C++ is weird about pointers to member functions.
 
+static void
+ConsoleInputReady(void *c)
+{
+    ASSERT(c != NULL);
+    Console *console = (Console *) c;
+    console->InputReady();
+}
+
 static void
 ConsoleReadPoll(void *c)
 {
@@ -70,44 +81,54 @@ Console::Console(const char *readFile, const char *writeFile,
     putBusy      = false;
     incoming     = EOF;
 
-    // Start polling for incoming packets.
-    interrupt->Schedule(ConsoleReadPoll, this,
-                        CONSOLE_TIME, CONSOLE_READ_INT);
+    // Wait for the first character.
+    WatchFile(readFileNo, ConsoleInputReady, this);
 }
 
 /// Clean up console emulation.
 Console::~Console()
 {
+    UnwatchFile(readFileNo);
     if (readFileNo != 0)
         Close(readFileNo);
     if (writeFileNo != 1)
         Close(writeFileNo);
 }
 
-/// Periodically called to check if a character is available for
-/// input from the simulated keyboard (eg, has it been typed?).
+/// Called when the host has input for the simulated keyboard (eg, it has
+/// been typed): the character arrives after the time it takes to read one.
+void
+Console::InputReady()
+{
+    interrupt->Schedule(ConsoleReadPoll, this,
+                        CONSOLE_TIME, CONSOLE_READ_INT);
+}
+
+/// Called when a character typed has arrived at the simulated keyboard.
 ///
 /// Only read it in if there is buffer space for it (if the previous
-/// character has been grabbed out of the buffer by the Nachos kernel).
-/// Invoke the “read” interrupt handler, once the character has been put into
-/// the buffer.
-    void
+/// character has been grabbed out of the buffer by the Nachos kernel);
+/// otherwise, try again later.  Invoke the “read” interrupt handler, once
+/// the character has been put into the buffer, and wait for the next one.
+///
+/// At the end of the keyboard file, nothing more ever arrives.
+void
 Console::CheckCharAvail()
 {
     char c;
 
-    // Schedule the next time to poll for a packet.
-    interrupt->Schedule(ConsoleReadPoll, this,
-            CONSOLE_TIME, CONSOLE_READ_INT);
-
-    // Do nothing if character is already buffered, or none to be read.
-    if (incoming != EOF || !PollFile(readFileNo))
+    if (incoming != EOF) {
+        interrupt->Schedule(ConsoleReadPoll, this,
+                            CONSOLE_TIME, CONSOLE_READ_INT);
+        return;
+    }
+    if (ReadPartial(readFileNo, &c, sizeof c) <= 0)
         return;
 
-    // Otherwise, read character and tell user about it.
-    Read(readFileNo, &c, sizeof c);
+    // Tell user about the character, and wait for another one.
     incoming = c;
     stats->numConsoleCharsRead++;
+    WatchFile(readFileNo, ConsoleInputReady, this);
     (*readHandler)(handlerArg);
 }
 
@@ -62,6 +62,7 @@ public:
     // Internal routines to signal I/O completion.
 
     void WriteDone();
+    void InputReady();
     void CheckCharAvail();
 
   private:
@@ -16,6 +16,9 @@
 
 #include "disk.hh"
 #include "threads/system.hh"
+#ifdef USER_PROGRAM
+#include "userprog/snapshot.hh"
+#endif
 
 
 /// We put this at the front of the UNIX file representing the
@@ -50,7 +53,8 @@ Disk::Disk(const char *name, VoidFunctionPtr callWhenDone, void *callArg)
     int magicNum;
     int tmp = 0;
 
-    DEBUG('d', "Initializing the disk, 0x%X 0x%X\n", callWhenDone, callArg);
+    DEBUG('d', "Initializing the disk, %p %p\n",
+          (void *) callWhenDone, callArg);
     handler    = callWhenDone;
     handlerArg = callArg;
     lastSector = 0;
@@ -260,3 +264,39 @@ Disk::UpdateLast(unsigned newSector)
     lastSector = newSector;
     DEBUG('d', "Updating last sector = %u, %u\n", lastSector, bufferInit);
 }
+
+#ifdef USER_PROGRAM
+void
+Disk::Save(Snapshot *snapshot) const
+{
+    ASSERT(snapshot != NULL);
+    ASSERT(!active);
+
+    char data[SECTOR_SIZE];
+
+    snapshot->Write(&lastSector, sizeof lastSector);
+    snapshot->Write(&bufferInit, sizeof bufferInit);
+    for (unsigned i = 0; i < NUM_SECTORS; i++) {
+        Lseek(fileno, SECTOR_SIZE * i + MAGIC_SIZE, 0);
+        Read(fileno, data, SECTOR_SIZE);
+        snapshot->Write(data, SECTOR_SIZE);
+    }
+}
+
+void
+Disk::Restore(Snapshot *snapshot)
+{
+    ASSERT(snapshot != NULL);
+    ASSERT(!active);
+
+    char data[SECTOR_SIZE];
+
+    snapshot->Read(&lastSector, sizeof lastSector);
+    snapshot->Read(&bufferInit, sizeof bufferInit);
+    for (unsigned i = 0; i < NUM_SECTORS; i++) {
+        snapshot->Read(data, SECTOR_SIZE);
+        Lseek(fileno, SECTOR_SIZE * i + MAGIC_SIZE, 0);
+        WriteFile(fileno, data, SECTOR_SIZE);
+    }
+}
+#endif
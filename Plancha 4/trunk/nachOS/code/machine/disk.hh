@@ -22,6 +22,8 @@
 #include "lib/utility.hh"
 
 
+class Snapshot;
+
 /// The following class defines a physical disk I/O device.
 ///
 /// The disk has a single surface, split up into “tracks”, and each track
@@ -82,6 +84,15 @@ public:
     ///     (seek + rotational delay + transfer)
     int ComputeLatency(unsigned newSector, bool writing);
 
+#ifdef USER_PROGRAM
+    /// Save the contents of every sector, and the position of the head, to
+    /// `snapshot`.  There must be no request in progress.
+    void Save(Snapshot *snapshot) const;
+
+    /// Overwrite the whole disk with the image in `snapshot`.
+    void Restore(Snapshot *snapshot);
+#endif
+
 private:
     int fileno;  ///< UNIX file number for simulated disk.
     VoidFunctionPtr handler;  ///< Interrupt handler, to be invoked when any
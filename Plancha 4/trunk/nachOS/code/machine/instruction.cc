@@ -47,6 +47,43 @@ Instruction::Decode()
         else
             opCode = OP_UNIMP;
     }
+
+    // Registers read.  Loads and stores read their base register; stores,
+    // and the partial word loads that merge into `rt`, read `rt` too.
+    switch (opCode) {
+        // Only `rs`.
+        case OP_ADDI: case OP_ADDIU: case OP_ANDI:  case OP_ORI:
+        case OP_XORI: case OP_SLTI:  case OP_SLTIU:
+        case OP_BGEZ: case OP_BGEZAL: case OP_BGTZ: case OP_BLEZ:
+        case OP_BLTZ: case OP_BLTZAL:
+        case OP_JALR: case OP_JR:    case OP_MTHI:  case OP_MTLO:
+        case OP_LB:   case OP_LBU:   case OP_LH:    case OP_LHU:
+        case OP_LW:
+            sources = 1U << rs;
+            break;
+
+        // Only `rt`.
+        case OP_SLL: case OP_SRA: case OP_SRL:
+            sources = 1U << rt;
+            break;
+
+        // Both.
+        case OP_ADD:  case OP_ADDU: case OP_AND:   case OP_NOR:
+        case OP_OR:   case OP_SLT:  case OP_SLTU:  case OP_SUB:
+        case OP_SUBU: case OP_XOR:  case OP_SLLV:  case OP_SRAV:
+        case OP_SRLV: case OP_BEQ:  case OP_BNE:
+        case OP_MULT: case OP_MULTU: case OP_DIV:  case OP_DIVU:
+        case OP_LWL:  case OP_LWR:
+        case OP_SB:   case OP_SH:   case OP_SW:    case OP_SWL:
+        case OP_SWR:
+            sources = 1U << rs | 1U << rt;
+            break;
+
+        // None: J, JAL, LUI, MFHI, MFLO, SYSCALL, RFE and the rest.
+        default:
+            sources = 0;
+    }
+    sources &= ~1U;  // Register 0 is never loaded.
 }
 
 int
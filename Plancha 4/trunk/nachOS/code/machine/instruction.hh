@@ -33,6 +33,8 @@ public:
     unsigned char rs, rt, rd;  ///< Three registers from instruction.
     int extra;  ///< Immediate or target or shamt field or offset.
                 ///< Immediates are sign-extended.
+    unsigned sources;  ///< Bit `r` is set if the instruction reads general
+                       ///< register `r`, other than register 0.
 };
 
 
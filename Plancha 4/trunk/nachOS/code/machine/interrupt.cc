@@ -22,6 +22,9 @@
 
 #include "interrupt.hh"
 #include "threads/system.hh"
+#ifdef USER_PROGRAM
+#include "userprog/snapshot.hh"
+#endif
 
 #include <limits.h>
 
@@ -46,6 +49,9 @@ IsIntType(IntType t)
     return 0 <= t && t < NUM_INT_TYPES;
 }
 
+PendingInterrupt::PendingInterrupt()
+{}
+
 /// Initialize a hardware device interrupt that is to be scheduled to occur
 /// in the near future.
 ///
@@ -54,7 +60,7 @@ IsIntType(IntType t)
 /// * `time` is when (in simulated time) the interrupt is to occur.
 /// * `kind` is the hardware device that generated the interrupt.
 PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void *param,
-                                   unsigned time, IntType kind)
+                                   Ticks time, IntType kind)
 {
     ASSERT(func != NULL);
     ASSERT(IsIntType(kind));
@@ -63,6 +69,14 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void *param,
     arg     = param;
     when    = time;
     type    = kind;
+    order   = 0;
+}
+
+/// Return true if `a` is to fire before `b`.
+static inline bool
+Earlier(const PendingInterrupt &a, const PendingInterrupt &b)
+{
+    return a.when < b.when || (a.when == b.when && a.order < b.order);
 }
 
 /// Initialize the simulation of hardware device interrupts.
@@ -70,19 +84,28 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void *param,
 /// Interrupts start disabled, with no interrupts pending, etc.
 Interrupt::Interrupt()
 {
-    level         = INT_OFF;
-    pending       = new List<PendingInterrupt *>;
-    inHandler     = false;
-    yieldOnReturn = false;
-    status        = SYSTEM_MODE;
+    level             = INT_OFF;
+    pendingCapacity   = 16;
+    pending           = new PendingInterrupt[pendingCapacity];
+    numPending        = 0;
+    numScheduled      = 0;
+    sampler           = NULL;
+    samplerArg        = NULL;
+    samplePeriod      = 0;
+    sampleSeed        = 1;
+    nextSample        = TICKS_MAX;
+    nextHostPoll      = HOST_POLL_TIME;
+    inHandler         = false;
+    yieldOnReturn     = false;
+    status            = SYSTEM_MODE;
+    interruptedStatus = SYSTEM_MODE;
+    UpdateNextDue();
 }
 
 /// De-allocate the data structures needed by the interrupt simulation.
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-        delete pending->Pop();
-    delete pending;
+    delete [] pending;
 }
 
 /// Change interrupts to be enabled or disabled, without advancing the
@@ -142,22 +165,60 @@ Interrupt::Enable()
 /// * a user instruction is executed.
 void
 Interrupt::OneTick()
+{
+    AdvanceTicks(1);
+}
+
+/// Advance simulated time by several ticks, then check for pending
+/// interrupts once.
+///
+/// This is what the dynamic translator uses to account for a whole block of
+/// user instructions at a time.  It gives the same result as calling
+/// `OneTick` `count` times as long as `count` is not greater than
+/// `TicksUntilDue`, since then none of the checks but the last could have
+/// found an interrupt to fire.
+///
+/// Most ticks find nothing due; that is told by comparing against
+/// `nextDue`, without disabling interrupts or touching `pending`.
+///
+/// * `count` is the number of ticks to advance.
+void
+Interrupt::AdvanceTicks(unsigned count)
 {
     MachineStatus old = status;
 
     // Advance simulated time.
     if (status == SYSTEM_MODE) {
-        stats->totalTicks += SYSTEM_TICK;
-    stats->systemTicks += SYSTEM_TICK;
+        stats->totalTicks += SYSTEM_TICK * count;
+        stats->systemTicks += SYSTEM_TICK * count;
     } else {  // USER_PROGRAM
-    stats->totalTicks += USER_TICK;
-    stats->userTicks += USER_TICK;
+        stats->totalTicks += USER_TICK * count;
+        stats->userTicks += USER_TICK * count;
+    }
+
+    // Nothing to fire and no context switch requested.  When tracing,
+    // `nextDue` is 0, so that every tick goes the long way and the trace
+    // shows every check.
+    if (stats->totalTicks < nextDue && !yieldOnReturn) {
+        level = INT_ON;
+        return;
+    }
+    DEBUG('i', "== Tick %llu ==\n", stats->totalTicks);
+
+    if (stats->totalTicks >= nextSample) {
+        ScheduleSample();
+        (*sampler)(samplerArg);
     }
-    DEBUG('i', "== Tick %u ==\n", stats->totalTicks);
 
     // Check any pending interrupts are now ready to fire.
     ChangeLevel(INT_ON, INT_OFF);  // First, turn off interrupts (interrupt
                                    // handlers run with interrupts disabled).
+    if (stats->totalTicks >= nextHostPoll) {
+        nextHostPoll = stats->totalTicks + HOST_POLL_TIME;
+        UpdateNextDue();
+        PollHostFiles(false);      // Devices schedule the arrival of any
+                                   // input the host has for them.
+    }
     while (CheckIfDue(false))      // Check for pending interrupts.
         ;
     ChangeLevel(INT_OFF, INT_ON);  // Re-enable interrupts.
@@ -176,6 +237,10 @@ Interrupt::OneTick()
 ///
 /// We cannot do the context switch here, because that would switch out the
 /// interrupt handler, and we want to switch out the interrupted thread.
+///
+/// Outside of an interrupt handler, the switch happens at the next tick;
+/// being just a store, this can even be called from a host signal
+/// handler.
 void
 Interrupt::YieldOnReturn()
 {
@@ -183,21 +248,37 @@ Interrupt::YieldOnReturn()
     yieldOnReturn = true;
 }
 
+/// Return how many ticks from now the first pending interrupt, or the next
+/// sample, is due.
+unsigned
+Interrupt::TicksUntilDue() const
+{
+    if (nextDue == TICKS_MAX)
+        return UINT_MAX;
+    if (nextDue <= stats->totalTicks)
+        return 0;
+    return nextDue - stats->totalTicks < UINT_MAX
+           ? nextDue - stats->totalTicks : UINT_MAX;
+}
+
 /// Routine called when there is nothing in the ready queue.
 ///
 /// Since something has to be running in order to put a thread on the ready
 /// queue, the only thing to do is to advance simulated time until the next
 /// scheduled hardware interrupt.
 ///
-/// If there are no pending interrupts, stop.  There is nothing more for us
-/// to do.
+/// If there are no pending interrupts, wait on the host until some device
+/// gets input, if any is waiting for it.  Otherwise stop.  There is nothing
+/// more for us to do.
 void
 Interrupt::Idle()
 {
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IDLE_MODE;
+    PollHostFiles(false);  // Input that came while the CPU was busy.
     if (CheckIfDue(true)) {        // Check for any pending interrupts.
         while (CheckIfDue(false))  // Check for any other pending interrupts.
+            ;
         yieldOnReturn = false;     // Since there is nothing in the ready
                                    // queue, the yield is automatic.
         status = SYSTEM_MODE;
@@ -205,10 +286,18 @@ Interrupt::Idle()
                                    // thread.
     }
 
+    // Block the host process, rather than poll, until a device has input
+    // to deliver; its arrival interrupt is then pending.
+    DEBUG('i', "Machine idle.  Waiting for host input.\n");
+    if (PollHostFiles(true)) {
+        status = SYSTEM_MODE;
+        return;
+    }
+
     // If there are no pending interrupts, and nothing is on the ready queue,
-    // it is time to stop.  If the console or the network is operating, there
-    // are *always* pending interrupts, so this code is not reached.
-    // Instead, the halt must be invoked by the user program.
+    // it is time to stop.  While the console or the network is waiting for
+    // input, this code is not reached.  Instead, the halt must be invoked by
+    // the user program.
 
     DEBUG('i', "Machine idle.  No interrupts to do.\n");
     printf("No threads ready or runnable, and no pending interrupts.\n");
@@ -221,44 +310,22 @@ void
 Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
+#ifdef USER_PROGRAM
+    machine->UpdateStatistics();
+#endif
     stats->Print();
+    scheduler->PrintStatistics();
+#ifdef USER_PROGRAM
+    if (profiler != NULL)
+        profiler->Print();
+#endif
     Cleanup();  // Never returns.
 }
 
-#ifdef DFS_TICKS_FIX
-/// Restart the total ticks statistic and the pending interrupts list.
-///
-/// This function makes sure Nachos keeps working even after overflowing the
-/// tick counter.  After some time (when `totalTicks` reach the maximum
-/// positive number) Nachos would schedule a pending interrupt at a negative
-/// time, and after that, it would hang.
-void
-Interrupt::RestartTicks()
-{
-    PendingInterrupt *i = NULL;
-    unsigned          newWhen, oldWhen = 0;
-
-    List<PendingInterrupt *> *oldPending = pending;
-    pending = new List<PendingInterrupt *>;
-
-    while ((i = oldPending->SortedPop((int *) &oldWhen)) != NULL)
-    {
-        newWhen = oldWhen - stats->totalTicks;
-        pending->SortedInsert(i, newWhen);
-        DEBUG('x', "Interrupt at time %u re-scheduled at new time %u.\n",
-              oldWhen, newWhen);
-    }
-
-    delete oldPending;
-    stats->totalTicks = 0;
-    stats->tickResets += 1;
-}
-#endif
-
 /// Arrange for the CPU to be interrupted when simulated time reaches `now +
 /// when`.
 ///
-/// Implementation: just put it on a sorted list.
+/// Implementation: just put it on a heap.
 ///
 /// NOTE: the Nachos kernel should not call this routine directly.  Instead,
 /// it is only called by the hardware device simulators.
@@ -276,26 +343,148 @@ Interrupt::Schedule(VoidFunctionPtr handler, void *arg,
     ASSERT(fromNow > 0);
     ASSERT(IsIntType(type));
 
-#ifdef DFS_TICKS_FIX
-    if (UINT_MAX - stats->totalTicks < fromNow)
-    {
-        DEBUG('x', "WARNING: total tick count is too large"
-                   " and will be reset.\n");
-        RestartTicks();
-    }
-#else
     // Terminate Nachos if the ticks overflowed.
-    ASSERT(UINT_MAX - stats->totalTicks > fromNow);
-#endif
+    ASSERT(TICKS_MAX - stats->totalTicks > fromNow);
 
-    unsigned when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg,
-                                                     when, type);
+    Ticks when = stats->totalTicks + fromNow;
 
-    DEBUG('i', "Scheduling interrupt handler the %s at time = %u\n",
+    DEBUG('i', "Scheduling interrupt handler the %s at time = %llu\n",
           INT_TYPE_NAMES[type], when);
 
-    pending->SortedInsert(toOccur, when);
+    Push(PendingInterrupt(handler, arg, when, type));
+}
+
+/// The heap is rebuilt from the interrupts kept, sifting each one up as
+/// `Push` does; but they keep their `order`, so those due at the same time
+/// still fire in the order they were scheduled.
+///
+/// * `type` is the hardware device whose interrupts are cancelled.
+void
+Interrupt::Cancel(IntType type)
+{
+    ASSERT(IsIntType(type));
+
+    DEBUG('i', "Cancelling interrupts from the %s\n", INT_TYPE_NAMES[type]);
+
+    // Entries are only ever moved to positions already visited.
+    unsigned kept = 0;
+    for (unsigned i = 0; i < numPending; i++) {
+        if (pending[i].type == type)
+            continue;
+        PendingInterrupt entry = pending[i];
+        unsigned j = kept++;
+        while (j > 0 && Earlier(entry, pending[(j - 1) / 2])) {
+            pending[j] = pending[(j - 1) / 2];
+            j = (j - 1) / 2;
+        }
+        pending[j] = entry;
+    }
+    numPending = kept;
+    UpdateNextDue();
+}
+
+void
+Interrupt::UpdateNextDue()
+{
+    nextDue = numPending == 0 ? TICKS_MAX : pending[0].when;
+    if (nextSample < nextDue)
+        nextDue = nextSample;
+    if (nextHostPoll < nextDue)
+        nextDue = nextHostPoll;
+    if (DebugIsEnabled('i'))
+        nextDue = 0;
+}
+
+/// Start sampling: from now on, `handler` is called every `period` ticks on
+/// average.
+///
+/// Samples are taken by `AdvanceTicks`, that is, while the CPU is executing
+/// user instructions or the kernel is running with interrupts enabled; they
+/// are skipped while the machine idles.
+///
+/// * `handler` is the procedure to call; it can ask `GetStatus` what the
+///   machine was doing.
+/// * `arg` is the argument to pass to `handler`.
+/// * `period` is the number of ticks between samples.
+void
+Interrupt::SetSampler(VoidFunctionPtr handler, void *arg, unsigned period)
+{
+    ASSERT(handler != NULL);
+    ASSERT(period > 0);
+
+    sampler      = handler;
+    samplerArg   = arg;
+    samplePeriod = period;
+    ScheduleSample();
+}
+
+/// Samples taken at a fixed period would lock on anything else periodic,
+/// such as the timer and the context switches it causes, and see the same
+/// thing every time.  The delay is drawn from a generator of its own, so
+/// that sampling does not change the sequence `Random` gives to the rest of
+/// Nachos.
+void
+Interrupt::ScheduleSample()
+{
+    // A xorshift generator.
+    sampleSeed ^= sampleSeed << 13;
+    sampleSeed ^= sampleSeed >> 17;
+    sampleSeed ^= sampleSeed << 5;
+
+    nextSample = stats->totalTicks + samplePeriod / 2 + 1
+                 + sampleSeed % samplePeriod;
+    UpdateNextDue();
+}
+
+/// Insert `toOccur` in the heap, after every interrupt already scheduled
+/// for the same time, growing the heap if it is full.
+void
+Interrupt::Push(const PendingInterrupt &toOccur)
+{
+    if (numPending == pendingCapacity) {
+        PendingInterrupt *bigger = new PendingInterrupt[2 * pendingCapacity];
+        for (unsigned i = 0; i < numPending; i++)
+            bigger[i] = pending[i];
+        delete [] pending;
+        pending = bigger;
+        pendingCapacity *= 2;
+    }
+
+    // Sift up from the new leaf.
+    unsigned i = numPending++;
+    PendingInterrupt entry = toOccur;
+    entry.order = numScheduled++;
+    while (i > 0 && Earlier(entry, pending[(i - 1) / 2])) {
+        pending[i] = pending[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    pending[i] = entry;
+    UpdateNextDue();
+}
+
+/// Remove the root of the heap.
+void
+Interrupt::RemoveFirst()
+{
+    ASSERT(numPending > 0);
+
+    // Sift the last leaf down from the root.
+    PendingInterrupt last = pending[--numPending];
+    unsigned i = 0;
+    for (;;) {
+        unsigned child = 2 * i + 1;
+        if (child >= numPending)
+            break;
+        if (child + 1 < numPending
+              && Earlier(pending[child + 1], pending[child]))
+            child++;
+        if (!Earlier(pending[child], last))
+            break;
+        pending[i] = pending[child];
+        i = child;
+    }
+    pending[i] = last;
+    UpdateNextDue();
 }
 
 /// Check if an interrupt is scheduled to occur, and if so, fire it off.
@@ -310,45 +499,42 @@ bool
 Interrupt::CheckIfDue(bool advanceClock)
 {
     MachineStatus old = status;
-    unsigned      when;
 
     ASSERT(level == INT_OFF);  // Interrupts need to be disabled, to invoke
                                // an interrupt handler.
     if (DebugIsEnabled('i'))
         DumpState();
-    PendingInterrupt *toOccur = pending->SortedPop((int *) &when);
 
-    if (toOccur == NULL)  // No pending interrupts.
-    return false;
+    if (numPending == 0)  // No pending interrupts.
+        return false;
+    PendingInterrupt toOccur = pending[0];
 
-    if (advanceClock && when > stats->totalTicks) {  // Advance the clock.
-        stats->idleTicks += (when - stats->totalTicks);
-        stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {  // Not time yet, put it back.
-        pending->SortedInsert(toOccur, when);
+    if (advanceClock && toOccur.when > stats->totalTicks) {
+        // Advance the clock.
+        stats->idleTicks += toOccur.when - stats->totalTicks;
+        stats->totalTicks = toOccur.when;
+    } else if (toOccur.when > stats->totalTicks)  // Not time yet.
         return false;
-    }
 
     // Check if there is nothing more to do, and if so, quit.
-    if (status == IDLE_MODE && toOccur->type == TIMER_INT
-          && pending->IsEmpty()) {
-        pending->SortedInsert(toOccur, when);
+    if (status == IDLE_MODE && toOccur.type == TIMER_INT
+          && numPending == 1)
         return false;
-    }
+    RemoveFirst();
 
-    DEBUG('i', "Invoking interrupt handler for the %s at time %u\n",
-            INT_TYPE_NAMES[toOccur->type], toOccur->when);
+    DEBUG('i', "Invoking interrupt handler for the %s at time %llu\n",
+            INT_TYPE_NAMES[toOccur.type], toOccur.when);
 #ifdef USER_PROGRAM
     if (machine != NULL)
         machine->DelayedLoad(0, 0);
 #endif
     inHandler = true;
+    interruptedStatus = old;
     status = SYSTEM_MODE;  // Whatever we were doing, we are now going to be
                            // running in the kernel.
-    (*toOccur->handler)(toOccur->arg);  // Call the interrupt handler.
+    (*toOccur.handler)(toOccur.arg);  // Call the interrupt handler.
     status = old;  // Restore the machine status.
     inHandler = false;
-    delete toOccur;
     return true;
 }
 
@@ -364,6 +550,12 @@ Interrupt::GetStatus() const
     return status;
 }
 
+MachineStatus
+Interrupt::GetInterruptedStatus() const
+{
+    return interruptedStatus;
+}
+
 void
 Interrupt::SetStatus(MachineStatus st)
 {
@@ -373,25 +565,125 @@ Interrupt::SetStatus(MachineStatus st)
 /// Print information about an interrupt that is scheduled to occur.  When,
 /// where, why, etc.
 static void
-PrintPending(PendingInterrupt *pend)
+PrintPending(const PendingInterrupt *pend)
 {
     ASSERT(pend != NULL);
 
-    printf("    Handler %s, scheduled at %u\n",
+    printf("    Handler %s, scheduled at %llu\n",
            INT_TYPE_NAMES[pend->type], pend->when);
 }
 
+/// Compare two pending interrupts for `qsort`, by firing order.
+static int
+ComparePending(const void *a, const void *b)
+{
+    const PendingInterrupt *x = (const PendingInterrupt *) a;
+    const PendingInterrupt *y = (const PendingInterrupt *) b;
+
+    return Earlier(*x, *y) ? -1 : Earlier(*y, *x) ? 1 : 0;
+}
+
 /// Print the complete interrupt state -- the status, and all interrupts that
 /// are scheduled to occur in the future.
 void
 Interrupt::DumpState()
 {
-    printf("Time: %u, interrupts %s\n",
+    printf("Time: %llu, interrupts %s\n",
            stats->totalTicks, INT_LEVEL_NAMES[level]);
-    if (pending->IsEmpty())
+    if (numPending == 0)
         printf("No pending interrupts\n");
     else {
+        // The heap is not sorted; print a sorted copy.
+        PendingInterrupt *sorted = new PendingInterrupt[numPending];
+        for (unsigned i = 0; i < numPending; i++)
+            sorted[i] = pending[i];
+        qsort(sorted, numPending, sizeof *sorted, ComparePending);
+
         printf("Pending interrupts:\n");
-        pending->Apply(PrintPending);
+        for (unsigned i = 0; i < numPending; i++)
+            PrintPending(&sorted[i]);
+        delete [] sorted;
+    }
+}
+
+#ifdef USER_PROGRAM
+bool
+Interrupt::IsPending(IntType type) const
+{
+    ASSERT(IsIntType(type));
+
+    for (unsigned i = 0; i < numPending; i++)
+        if (pending[i].type == type)
+            return true;
+    return false;
+}
+
+/// Handlers and their arguments are host addresses, which mean nothing to
+/// another run; only the kind of device tells whose each interrupt is.
+void
+Interrupt::Save(Snapshot *snapshot) const
+{
+    ASSERT(snapshot != NULL);
+
+    snapshot->Write(&numPending, sizeof numPending);
+    snapshot->Write(&numScheduled, sizeof numScheduled);
+    for (unsigned i = 0; i < numPending; i++) {
+        snapshot->Write(&pending[i].type, sizeof pending[i].type);
+        snapshot->Write(&pending[i].when, sizeof pending[i].when);
+        snapshot->Write(&pending[i].order, sizeof pending[i].order);
+    }
+}
+
+/// The devices of a freshly started Nachos have scheduled one interrupt
+/// each, of the same kinds as the ones saved (devices with a request in
+/// progress cannot be saved); they are matched by kind, and put back in the
+/// order they were first scheduled.
+void
+Interrupt::Restore(Snapshot *snapshot)
+{
+    ASSERT(snapshot != NULL);
+
+    unsigned           count;
+    unsigned long long scheduled;
+
+    snapshot->Read(&count, sizeof count);
+    snapshot->Read(&scheduled, sizeof scheduled);
+    ASSERT(count == numPending);
+
+    PendingInterrupt *live  = new PendingInterrupt[count];
+    PendingInterrupt *saved = new PendingInterrupt[count];
+    for (unsigned i = 0; i < count; i++) {
+        live[i] = pending[i];
+        snapshot->Read(&saved[i].type, sizeof saved[i].type);
+        snapshot->Read(&saved[i].when, sizeof saved[i].when);
+        snapshot->Read(&saved[i].order, sizeof saved[i].order);
     }
+
+    numPending = 0;
+    for (unsigned done = 0; done < count; done++) {
+        // The saved interrupt scheduled first among those left.
+        unsigned first = count;
+        for (unsigned i = 0; i < count; i++)
+            if (saved[i].order != ULLONG_MAX
+                  && (first == count || saved[i].order < saved[first].order))
+                first = i;
+
+        unsigned match = 0;
+        while (match < count && (live[match].handler == NULL
+                                 || live[match].type != saved[first].type))
+            match++;
+        ASSERT(match < count);
+
+        live[match].when = saved[first].when;
+        Push(live[match]);
+        live[match].handler = NULL;
+        saved[first].order = ULLONG_MAX;
+    }
+    numScheduled = scheduled;
+    delete [] live;
+    delete [] saved;
+
+    if (sampler != NULL)
+        ScheduleSample();
 }
+#endif
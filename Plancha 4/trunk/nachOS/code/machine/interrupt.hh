@@ -35,7 +35,11 @@
 #define NACHOS_MACHINE_INTERRUPT__HH
 
 
-#include "lib/list.hh"
+#include "statistics.hh"
+#include "lib/utility.hh"
+
+
+class Snapshot;
 
 
 /// Interrupts can be disabled (`INT_OFF`) or enabled (`INT_ON`).
@@ -76,16 +80,22 @@ enum IntType {
 class PendingInterrupt {
 public:
 
+    /// Leave the interrupt uninitialized, as storage for `Interrupt`.
+    PendingInterrupt();
+
     /// initialize an interrupt that will occur in the future.
     PendingInterrupt(VoidFunctionPtr func, void *param,
-                     unsigned time, IntType kind);
+                     Ticks time, IntType kind);
 
     VoidFunctionPtr handler;  ///< The function (in the hardware device
                               ///< emulator) to call when the interrupt
                               ///< occurs.
     void *arg;  ///< The argument to the function.
-    unsigned when;  ///< When the interrupt is supposed to fire.
+    Ticks when;  ///< When the interrupt is supposed to fire.
     IntType type;  ///< For debugging.
+    unsigned long long order;  ///< Number of interrupts scheduled before
+                               ///< this one; interrupts due at the same
+                               ///< time fire in this order.
 };
 
 /// The following class defines the data structures for the simulation
@@ -126,6 +136,10 @@ public:
 
     void SetStatus(MachineStatus st);
 
+    /// Inside an interrupt handler, what the machine was doing when the
+    /// interrupt fired (`GetStatus` says `SYSTEM_MODE` then).
+    MachineStatus GetInterruptedStatus() const;
+
     // Print interrupt state.
     void DumpState();
 
@@ -141,32 +155,100 @@ public:
     void Schedule(VoidFunctionPtr handler, void *arg,
                   unsigned when, IntType type);
 
+    /// Forget every pending interrupt of kind `type`.
+    ///
+    /// This is called by the hardware device simulators.
+    void Cancel(IntType type);
+
     /// Advance simulated time.
     void OneTick();
 
+    /// Advance simulated time by `count` ticks at once, as if `OneTick` had
+    /// been called `count` times.  Only exact when no interrupt falls due
+    /// before the last of those ticks (see `TicksUntilDue`).
+    void AdvanceTicks(unsigned count);
+
+    /// Number of ticks that can elapse before the next pending interrupt
+    /// or sample falls due; `UINT_MAX` if there is none.
+    unsigned TicksUntilDue() const;
+
+    /// Call `handler` with `arg` every `period` ticks of simulated time, on
+    /// average, from `AdvanceTicks`, in whatever mode the machine was (see
+    /// `GetStatus`).  Unlike an interrupt, a sample does not touch the
+    /// machine state, and never keeps an idle machine running.
+    void SetSampler(VoidFunctionPtr handler, void *arg, unsigned period);
+
+#ifdef USER_PROGRAM
+    /// Return true if an interrupt of kind `type` is pending.
+    bool IsPending(IntType type) const;
+
+    /// Save the times of the pending interrupts to `snapshot`.
+    void Save(Snapshot *snapshot) const;
+
+    /// Give the interrupts the devices have scheduled so far the times
+    /// saved in `snapshot`.  Simulated time must have been restored first.
+    void Restore(Snapshot *snapshot);
+#endif
+
 private:
     IntStatus level;  ///< Are interrupts enabled or disabled?
-    List<PendingInterrupt *> *pending;  ///< The list of interrupts scheduled
-                                        ///< to occur in the future.
+
+    /// Interrupts scheduled to occur in the future, as a binary min-heap
+    /// ordered by `when` and then by `order`: the children of
+    /// `pending[i]` are `pending[2 * i + 1]` and `pending[2 * i + 2]`.
+    ///
+    /// The array only ever grows, so once it is big enough, scheduling an
+    /// interrupt allocates nothing.
+    PendingInterrupt *pending;
+    unsigned numPending;       ///< Entries of `pending` in use.
+    unsigned pendingCapacity;  ///< Entries allocated for `pending`.
+    unsigned long long numScheduled;  ///< Interrupts scheduled so far.
+
+    VoidFunctionPtr sampler;  ///< Called every `samplePeriod` ticks, if not
+                              ///< `NULL`.
+    void *samplerArg;         ///< Argument to pass to `sampler`.
+    unsigned samplePeriod;
+    unsigned sampleSeed;      ///< State of the generator that spreads samples.
+    Ticks nextSample;         ///< When `sampler` is next due.
+    Ticks nextHostPoll;       ///< When to next check for host input (see
+                              ///< `PollHostFiles`).
+
+    Ticks nextDue;  ///< When the first interrupt in `pending`, the next
+                    ///< sample or the next host poll is due (0 while
+                    ///< tracing interrupts), so that most ticks need not
+                    ///< look at the queue at all.
     bool inHandler;  ///< True if we are running an interrupt handler.
-    bool yieldOnReturn;  ///< True if we are to context switch on return from
-                         ///< the interrupt handler.
+    volatile bool yieldOnReturn;  ///< True if we are to context switch on
+                                  ///< return from the interrupt handler,
+                                  ///< or at the next tick (also set from
+                                  ///< a signal handler by the preemptive
+                                  ///< scheduler).
     MachineStatus status;  ///< Idle, kernel mode, user mode.
+    MachineStatus interruptedStatus;  ///< `status` when the interrupt being
+                                      ///< handled fired.
 
     /// These functions are internal to the interrupt simulation code.
 
     /// Check if an interrupt is supposed to occur now.
     bool CheckIfDue(bool advanceClock);
 
+    /// Set `nextSample` to a random time, `samplePeriod` ticks from now on
+    /// average.
+    void ScheduleSample();
+
+    /// Set `nextDue` after `pending` or `nextSample` changes.
+    void UpdateNextDue();
+
+    /// Add `toOccur` to `pending`.
+    void Push(const PendingInterrupt &toOccur);
+
+    /// Remove the first interrupt due from `pending`.
+    void RemoveFirst();
+
     /// SetLevel, without advancing the simulated time.
     void ChangeLevel(IntStatus old,
                      IntStatus now);
 
-#ifdef DFS_TICKS_FIX
-    /// Restart total ticks and the pending interrupt list.
-    void RestartTicks();
-#endif
-
 };
 
 
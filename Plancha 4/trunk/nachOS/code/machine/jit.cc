@@ -0,0 +1,729 @@
+/// Dynamic translation of hot basic blocks to x86-64 host code.
+///
+/// Blocks of the threaded-code interpreter (see `block_sim.cc`) that have
+/// run `jitThreshold` times get the longest prefix of them that we know how
+/// to translate turned into a host function.  The generated code works
+/// directly on `Machine::registers`, and leaves them exactly as
+/// `ExecInstruction` would after every instruction, delayed loads
+/// included.
+///
+/// Anything that would trap is left to the interpreter:
+/// * system calls and illegal instructions end the translated prefix;
+/// * loads and stores first check with `CanTranslate` that the access will
+///   not fault, and overflowing `add`/`sub` check the host overflow flag; if
+///   the check fails, the generated code returns before the instruction,
+///   which is then run (and restarted after the exception) by `RunBlock`;
+/// * a store that changes the code of the running block returns right after
+///   the store, since the rest of the block may be stale.
+///
+/// Simulated time is accounted for by `RunBlock`, with a single
+/// `AdvanceTicks` for all the instructions retired.
+///
+/// On hosts other than x86-64, nothing is ever translated.
+///
+/// DO NOT CHANGE -- part of the machine emulation
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "basic_block.hh"
+#include "threads/system.hh"
+
+#include <stdint.h>
+
+
+/// Size of the memory that holds generated code.  When it fills up, all
+/// the code is thrown away and blocks are translated again as they get hot.
+static const unsigned JIT_AREA_SIZE = 4 * 1024 * 1024;
+
+/// Room for translating one block: generous for `MAX_BLOCK_LENGTH`
+/// instructions plus their exits.
+static const unsigned MAX_NATIVE_BLOCK_SIZE = 16 * 1024;
+
+/// Load `value` from the user address `addr`, if it can be done without an
+/// exception.
+///
+/// Returns 0 (and does nothing else) if the access would trap.
+int
+Machine::JitLoad(Machine *m, unsigned addr, unsigned size, int *value)
+{
+    if (!m->CanTranslate(addr, size, false))
+        return 0;
+    return m->ReadMem(addr, size, value);
+}
+
+/// Store `value` at the user address `addr`, if it can be done without an
+/// exception.
+///
+/// Returns 0 (and does nothing else) if the access would trap, 2 if the
+/// store modified the frame of the block being run, 1 otherwise.
+int
+Machine::JitStore(Machine *m, unsigned addr, unsigned size, int value)
+{
+    if (!m->CanTranslate(addr, size, true))
+        return 0;
+
+    unsigned generation = m->codeGeneration[m->jitFrame];
+    m->WriteMem(addr, size, value);
+    return m->codeGeneration[m->jitFrame] == generation ? 1 : 2;
+}
+
+/// Run an instruction that never traps but is not worth generating code
+/// for, such as multiplication and division.
+void
+Machine::JitExec(Machine *m, const Instruction *instr)
+{
+    m->ExecInstruction(instr);
+}
+
+#ifdef HOST_x86_64
+
+/// Host registers, by their number in instruction encodings.
+enum HostRegister { EAX = 0, ECX = 1, EDX = 2, EBX = 3, ESI = 6, EDI = 7 };
+
+/// Condition codes, as used in `jcc`/`cmovcc`/`setcc` encodings.
+enum HostCondition {
+    CC_O = 0x0, CC_B = 0x2, CC_E = 0x4, CC_NE = 0x5, CC_S = 0x8,
+    CC_NS = 0x9, CC_L = 0xC, CC_LE = 0xE, CC_G = 0xF
+};
+
+/// Minimal x86-64 assembler, just enough for `CompileBlock`.
+///
+/// While code is generated, `rbx` points to `registers` and `r12` to the
+/// `Machine`; `[rsp]` is a scratch word for `JitLoad`.
+class Emitter {
+public:
+    Emitter(unsigned char *buffer, unsigned capacity)
+    {
+        code = buffer;
+        size = capacity;
+        used = 0;
+    }
+
+    void Byte(unsigned b)
+    {
+        ASSERT(used < size);
+        code[used++] = b;
+    }
+
+    void Bytes(unsigned b0, unsigned b1)
+    {
+        Byte(b0);
+        Byte(b1);
+    }
+
+    void Bytes(unsigned b0, unsigned b1, unsigned b2)
+    {
+        Byte(b0);
+        Byte(b1);
+        Byte(b2);
+    }
+
+    void Word(unsigned w)
+    {
+        for (unsigned i = 0; i < 4; i++)
+            Byte(w >> 8 * i & 0xFF);
+    }
+
+    void Quad(uint64_t q)
+    {
+        Word((unsigned) q);
+        Word((unsigned) (q >> 32));
+    }
+
+    /// Any `op r32, [rbx + 4 * reg]` (or the reverse).
+    void RegisterOperand(unsigned opcode, HostRegister host, unsigned reg)
+    {
+        Byte(opcode);
+        Byte(0x83 | host << 3);
+        Word(reg * 4);
+    }
+
+    /// `mov host, registers[reg]`.
+    void Load(HostRegister host, unsigned reg)
+    {
+        RegisterOperand(0x8B, host, reg);
+    }
+
+    /// `mov registers[reg], host`.
+    void Store(unsigned reg, HostRegister host)
+    {
+        RegisterOperand(0x89, host, reg);
+    }
+
+    /// `mov registers[reg], imm`.
+    void StoreImmediate(unsigned reg, unsigned imm)
+    {
+        Bytes(0xC7, 0x83);
+        Word(reg * 4);
+        Word(imm);
+    }
+
+    /// `op host, imm32`, where `extension` selects add (0), or (1), and (4),
+    /// sub (5), xor (6) or cmp (7).
+    void ArithmeticImmediate(unsigned extension, HostRegister host,
+                             unsigned imm)
+    {
+        Bytes(0x81, 0xC0 | extension << 3 | host);
+        Word(imm);
+    }
+
+    /// `mov host, imm32`.
+    void MoveImmediate(HostRegister host, unsigned imm)
+    {
+        Byte(0xB8 | host);
+        Word(imm);
+    }
+
+    /// `mov r64, imm64`.
+    void MoveImmediate64(HostRegister host, uint64_t imm)
+    {
+        Bytes(0x48, 0xB8 | host);
+        Quad(imm);
+    }
+
+    /// `call function`.
+    void Call(const void *function)
+    {
+        MoveImmediate64(EAX, (uintptr_t) function);
+        Bytes(0xFF, 0xD0);
+    }
+
+    /// `jcc rel32` with a target to be patched in later; returns where.
+    unsigned JumpIf(HostCondition cc)
+    {
+        Bytes(0x0F, 0x80 | cc);
+        Word(0);
+        return used - 4;
+    }
+
+    /// `jmp rel32` with a target to be patched in later; returns where.
+    unsigned Jump()
+    {
+        Byte(0xE9);
+        Word(0);
+        return used - 4;
+    }
+
+    /// Make the jump whose displacement is at `at` land here.
+    void Patch(unsigned at)
+    {
+        unsigned rel = used - (at + 4);
+        for (unsigned i = 0; i < 4; i++)
+            code[at + i] = rel >> 8 * i & 0xFF;
+    }
+
+    unsigned char *code;
+    unsigned size;
+    unsigned used;
+};
+
+/// Return true if `opCode` is a branch or a jump.
+static bool
+IsBranch(unsigned opCode)
+{
+    switch (opCode) {
+        case OP_BEQ:  case OP_BNE:  case OP_BGEZ: case OP_BGEZAL:
+        case OP_BGTZ: case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL:
+        case OP_J:    case OP_JAL:  case OP_JALR: case OP_JR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/// Return true if we know how to generate code for `opCode`.
+static bool
+IsTranslatable(unsigned opCode)
+{
+    switch (opCode) {
+        case OP_ADD:  case OP_ADDI: case OP_ADDIU: case OP_ADDU:
+        case OP_AND:  case OP_ANDI: case OP_NOR:   case OP_OR:
+        case OP_ORI:  case OP_SUB:  case OP_SUBU:  case OP_XOR:
+        case OP_XORI: case OP_LUI:
+        case OP_SLL:  case OP_SLLV: case OP_SRA:   case OP_SRAV:
+        case OP_SRL:  case OP_SRLV:
+        case OP_SLT:  case OP_SLTI: case OP_SLTIU: case OP_SLTU:
+        case OP_MFHI: case OP_MFLO: case OP_MTHI:  case OP_MTLO:
+        case OP_MULT: case OP_MULTU: case OP_DIV:  case OP_DIVU:
+        case OP_LB:   case OP_LBU:  case OP_LH:    case OP_LHU:
+        case OP_LW:   case OP_SB:   case OP_SH:    case OP_SW:
+            return true;
+        default:
+            return IsBranch(opCode);
+    }
+}
+
+/// Generate the end of an instruction: the same as `DelayedLoad` with the
+/// load, if any, left in `edx`.
+static void
+EmitRetire(Emitter *e, unsigned nextLoadReg)
+{
+    e->Load(EAX, LOAD_REG);
+    e->Load(ECX, LOAD_VALUE_REG);
+    e->Bytes(0x89, 0x0C, 0x83);  // mov [rbx + rax * 4], ecx
+    e->StoreImmediate(LOAD_REG, nextLoadReg);
+    if (nextLoadReg != 0)
+        e->Store(LOAD_VALUE_REG, EDX);
+    else
+        e->StoreImmediate(LOAD_VALUE_REG, 0);
+    e->StoreImmediate(0, 0);
+}
+
+/// Generate a return from the host function, with `retired` instructions
+/// done, leaving the program counters as the interpreter would.
+///
+/// * `start` is the virtual address of the first instruction.
+/// * `branch` is the index of the branch in the block, or
+///   `MAX_BLOCK_LENGTH` if there is none.  Once it has retired, the generated code has been
+///   keeping the program counters up to date itself.
+/// * `epilogue` collects the jump to patch.
+static void
+EmitExit(Emitter *e, unsigned retired, unsigned start, unsigned branch,
+         unsigned *epilogue)
+{
+    if (retired > 0 && retired <= branch) {
+        e->StoreImmediate(PREV_PC_REG, start + 4 * (retired - 1));
+        e->StoreImmediate(PC_REG, start + 4 * retired);
+        e->StoreImmediate(NEXT_PC_REG, start + 4 * retired + 4);
+    }
+    e->MoveImmediate(EAX, retired);
+    *epilogue = e->Jump();
+}
+
+/// Translate the beginning of `block` into host code.
+///
+/// * `virtAddr` is the address the block is being run from.
+void
+Machine::CompileBlock(BasicBlock *block, unsigned virtAddr)
+{
+    ASSERT(block != NULL);
+
+    static unsigned char buffer[MAX_NATIVE_BLOCK_SIZE];
+
+    Emitter  e(buffer, MAX_NATIVE_BLOCK_SIZE);
+    unsigned length = 0;
+    unsigned branch = MAX_BLOCK_LENGTH;  // Index of the branch, if any.
+    unsigned exitJumps[MAX_BLOCK_LENGTH * 2], exitRetired[MAX_BLOCK_LENGTH * 2];
+    unsigned numExits = 0;
+    unsigned epilogues[MAX_BLOCK_LENGTH * 2 + 1], numEpilogues = 0;
+
+    // Pick the part to translate: everything up to the first instruction we
+    // cannot do, but a branch goes only together with its delay slot.
+    for (; length < block->length; length++) {
+        unsigned op = block->ops[length].instr.opCode;
+        if (!IsTranslatable(op))
+            break;
+        if (IsBranch(op)) {
+            if (length + 1 < block->length) {
+                unsigned slot = block->ops[length + 1].instr.opCode;
+                if (IsTranslatable(slot) && !IsBranch(slot)) {
+                    branch = length;
+                    length += 2;
+                }
+            }
+            break;
+        }
+    }
+    if (length == 0)
+        return;
+
+    // Prologue: keep `registers` in `rbx` and the machine in `r12`.
+    e.Byte(0x53);                    // push rbx
+    e.Bytes(0x41, 0x54);             // push r12
+    e.Bytes(0x41, 0x55);             // push r13
+    e.Bytes(0x48, 0x83, 0xEC); e.Byte(0x10);  // sub rsp, 16
+    e.Bytes(0x48, 0x89, 0xFB);       // mov rbx, rdi
+    e.Bytes(0x49, 0x89, 0xF4);       // mov r12, rsi
+
+    for (unsigned k = 0; k < length; k++) {
+        const Instruction *instr = &block->ops[k].instr;
+        unsigned addr = virtAddr + 4 * k;
+        unsigned nextLoadReg = 0;
+        bool     storeCheck = false;
+        bool     retire = true;
+
+        switch (instr->opCode) {
+            case OP_ADD:
+            case OP_SUB:
+                e.Load(EAX, instr->rs);
+                e.RegisterOperand(instr->opCode == OP_ADD ? 0x03 : 0x2B,
+                                  EAX, instr->rt);
+                exitRetired[numExits] = k;
+                exitJumps[numExits++] = e.JumpIf(CC_O);
+                e.Store(instr->rd, EAX);
+                break;
+
+            case OP_ADDI:
+                e.Load(EAX, instr->rs);
+                e.ArithmeticImmediate(0, EAX, instr->extra);
+                exitRetired[numExits] = k;
+                exitJumps[numExits++] = e.JumpIf(CC_O);
+                e.Store(instr->rt, EAX);
+                break;
+
+            case OP_ADDIU:
+            case OP_ANDI:
+            case OP_ORI:
+            case OP_XORI: {
+                unsigned extension = 0, imm = instr->extra & 0xFFFF;
+                if (instr->opCode == OP_ADDIU) {
+                    imm = instr->extra;
+                } else if (instr->opCode == OP_ANDI)
+                    extension = 4;
+                else if (instr->opCode == OP_ORI)
+                    extension = 1;
+                else
+                    extension = 6;
+                e.Load(EAX, instr->rs);
+                e.ArithmeticImmediate(extension, EAX, imm);
+                e.Store(instr->rt, EAX);
+                break;
+            }
+
+            case OP_ADDU:
+            case OP_SUBU:
+            case OP_AND:
+            case OP_OR:
+            case OP_XOR:
+            case OP_NOR: {
+                unsigned opcode = 0x03;
+                if (instr->opCode == OP_SUBU)
+                    opcode = 0x2B;
+                else if (instr->opCode == OP_AND)
+                    opcode = 0x23;
+                else if (instr->opCode == OP_OR || instr->opCode == OP_NOR)
+                    opcode = 0x0B;
+                else if (instr->opCode == OP_XOR)
+                    opcode = 0x33;
+                e.Load(EAX, instr->rs);
+                e.RegisterOperand(opcode, EAX, instr->rt);
+                if (instr->opCode == OP_NOR)
+                    e.Bytes(0xF7, 0xD0);  // not eax
+                e.Store(instr->rd, EAX);
+                break;
+            }
+
+            case OP_LUI:
+                e.StoreImmediate(instr->rt, instr->extra << 16);
+                break;
+
+            case OP_SLL:
+            case OP_SRA:
+            case OP_SRL:
+                // `ExecInstruction` shifts a signed temporary for `srl` too.
+                e.Load(EAX, instr->rt);
+                e.Bytes(0xC1, instr->opCode == OP_SLL ? 0xE0 : 0xF8,
+                        instr->extra & 0xFF);
+                e.Store(instr->rd, EAX);
+                break;
+
+            case OP_SLLV:
+            case OP_SRAV:
+            case OP_SRLV:
+                e.Load(ECX, instr->rs);
+                e.Load(EAX, instr->rt);
+                e.Bytes(0xD3, instr->opCode == OP_SLLV ? 0xE0 : 0xF8);
+                e.Store(instr->rd, EAX);
+                break;
+
+            case OP_SLT:
+            case OP_SLTU:
+            case OP_SLTI:
+            case OP_SLTIU: {
+                bool immediate = instr->opCode == OP_SLTI
+                                 || instr->opCode == OP_SLTIU;
+                bool isUnsigned = instr->opCode == OP_SLTU
+                                  || instr->opCode == OP_SLTIU;
+                e.Load(EAX, instr->rs);
+                if (immediate)
+                    e.ArithmeticImmediate(7, EAX, instr->extra);
+                else
+                    e.RegisterOperand(0x3B, EAX, instr->rt);
+                e.Bytes(0x0F, 0x90 | (isUnsigned ? CC_B : CC_L), 0xC0);
+                e.Bytes(0x0F, 0xB6, 0xC0);  // movzx eax, al
+                e.Store(immediate ? instr->rt : instr->rd, EAX);
+                break;
+            }
+
+            case OP_MFHI:
+            case OP_MFLO:
+                e.Load(EAX, instr->opCode == OP_MFHI ? HI_REG : LO_REG);
+                e.Store(instr->rd, EAX);
+                break;
+
+            case OP_MTHI:
+            case OP_MTLO:
+                e.Load(EAX, instr->rs);
+                e.Store(instr->opCode == OP_MTHI ? HI_REG : LO_REG, EAX);
+                break;
+
+            case OP_MULT:
+            case OP_MULTU:
+            case OP_DIV:
+            case OP_DIVU:
+                // `ExecInstruction` needs the program counters, and updates
+                // them itself.  In a delay slot they are already right.
+                if (k != branch + 1) {
+                    e.StoreImmediate(PC_REG, addr);
+                    e.StoreImmediate(NEXT_PC_REG, addr + 4);
+                }
+                e.Bytes(0x4C, 0x89, 0xE7);  // mov rdi, r12
+                e.MoveImmediate64(ESI, (uintptr_t) instr);
+                e.Call((const void *) JitExec);
+                retire = false;
+                break;
+
+            case OP_LB:
+            case OP_LBU:
+            case OP_LH:
+            case OP_LHU:
+            case OP_LW: {
+                unsigned size = instr->opCode == OP_LW ? 4
+                              : instr->opCode == OP_LH
+                                || instr->opCode == OP_LHU ? 2 : 1;
+                e.Load(ESI, instr->rs);
+                e.ArithmeticImmediate(0, ESI, instr->extra);
+                e.Bytes(0x4C, 0x89, 0xE7);  // mov rdi, r12
+                e.MoveImmediate(EDX, size);
+                e.Bytes(0x48, 0x89, 0xE1);  // mov rcx, rsp
+                e.Call((const void *) JitLoad);
+                e.Bytes(0x85, 0xC0);        // test eax, eax
+                exitRetired[numExits] = k;
+                exitJumps[numExits++] = e.JumpIf(CC_E);
+                e.Bytes(0x8B, 0x14, 0x24);  // mov edx, [rsp]
+                if (instr->opCode == OP_LB)
+                    e.Bytes(0x0F, 0xBE, 0xD2);  // movsx edx, dl
+                else if (instr->opCode == OP_LBU)
+                    e.Bytes(0x0F, 0xB6, 0xD2);  // movzx edx, dl
+                else if (instr->opCode == OP_LH)
+                    e.Bytes(0x0F, 0xBF, 0xD2);  // movsx edx, dx
+                else if (instr->opCode == OP_LHU)
+                    e.Bytes(0x0F, 0xB7, 0xD2);  // movzx edx, dx
+                nextLoadReg = instr->rt;
+                break;
+            }
+
+            case OP_SB:
+            case OP_SH:
+            case OP_SW:
+                e.Load(ESI, instr->rs);
+                e.ArithmeticImmediate(0, ESI, instr->extra);
+                e.Bytes(0x4C, 0x89, 0xE7);  // mov rdi, r12
+                e.MoveImmediate(EDX, instr->opCode == OP_SW ? 4
+                                     : instr->opCode == OP_SH ? 2 : 1);
+                e.Load(ECX, instr->rt);
+                e.Call((const void *) JitStore);
+                e.Bytes(0x41, 0x89, 0xC5);  // mov r13d, eax
+                e.Bytes(0x85, 0xC0);        // test eax, eax
+                exitRetired[numExits] = k;
+                exitJumps[numExits++] = e.JumpIf(CC_E);
+                storeCheck = true;
+                break;
+
+            case OP_BEQ:
+            case OP_BNE:
+            case OP_BGEZ:
+            case OP_BGEZAL:
+            case OP_BGTZ:
+            case OP_BLEZ:
+            case OP_BLTZ:
+            case OP_BLTZAL: {
+                HostCondition cc;
+                if (instr->opCode == OP_BGEZAL || instr->opCode == OP_BLTZAL)
+                    e.StoreImmediate(R31, addr + 8);
+                e.Load(EAX, instr->rs);
+                if (instr->opCode == OP_BEQ || instr->opCode == OP_BNE) {
+                    e.RegisterOperand(0x3B, EAX, instr->rt);
+                    cc = instr->opCode == OP_BEQ ? CC_E : CC_NE;
+                } else {
+                    e.Bytes(0x85, 0xC0);  // test eax, eax
+                    if (instr->opCode == OP_BGTZ)
+                        cc = CC_G;
+                    else if (instr->opCode == OP_BLEZ)
+                        cc = CC_LE;
+                    else if (instr->opCode == OP_BLTZ
+                             || instr->opCode == OP_BLTZAL)
+                        cc = CC_S;
+                    else
+                        cc = CC_NS;
+                }
+                e.MoveImmediate(EDX, addr + 8);
+                e.MoveImmediate(ECX, addr + 4 + IndexToAddr(instr->extra));
+                e.Bytes(0x0F, 0x40 | cc, 0xD1);  // cmovcc edx, ecx
+                e.Store(NEXT_PC_REG, EDX);
+                break;
+            }
+
+            case OP_J:
+            case OP_JAL:
+                if (instr->opCode == OP_JAL)
+                    e.StoreImmediate(R31, addr + 8);
+                e.StoreImmediate(NEXT_PC_REG,
+                                 ((addr + 8) & 0xF0000000)
+                                 | IndexToAddr(instr->extra));
+                break;
+
+            case OP_JALR:
+            case OP_JR:
+                if (instr->opCode == OP_JALR)
+                    e.StoreImmediate(instr->rd, addr + 8);
+                e.Load(EAX, instr->rs);
+                e.Store(NEXT_PC_REG, EAX);
+                break;
+
+            default:
+                ASSERT(false);
+        }
+
+        if (retire) {
+            EmitRetire(&e, nextLoadReg);
+            if (k == branch) {
+                e.StoreImmediate(PREV_PC_REG, addr);
+                e.StoreImmediate(PC_REG, addr + 4);
+            } else if (k == branch + 1) {
+                // End of the delay slot: go where the branch decided.
+                e.Load(EAX, NEXT_PC_REG);
+                e.Store(PC_REG, EAX);
+                e.Bytes(0x83, 0xC0, 0x04);  // add eax, 4
+                e.Store(NEXT_PC_REG, EAX);
+                e.StoreImmediate(PREV_PC_REG, addr);
+            }
+        }
+        if (storeCheck) {
+            // The block modified its own frame: stop right here.
+            e.Bytes(0x41, 0x83, 0xFD); e.Byte(0x02);  // cmp r13d, 2
+            exitRetired[numExits] = k + 1;
+            exitJumps[numExits++] = e.JumpIf(CC_E);
+        }
+    }
+
+    // Normal exit, then the early ones, then the epilogue they all share.
+    EmitExit(&e, length, virtAddr, branch, &epilogues[numEpilogues++]);
+    for (unsigned i = 0; i < numExits; i++) {
+        e.Patch(exitJumps[i]);
+        EmitExit(&e, exitRetired[i], virtAddr, branch,
+                 &epilogues[numEpilogues++]);
+    }
+    for (unsigned i = 0; i < numEpilogues; i++)
+        e.Patch(epilogues[i]);
+    e.Bytes(0x48, 0x83, 0xC4); e.Byte(0x10);  // add rsp, 16
+    e.Bytes(0x41, 0x5D);                     // pop r13
+    e.Bytes(0x41, 0x5C);                     // pop r12
+    e.Byte(0x5B);                            // pop rbx
+    e.Byte(0xC3);                            // ret
+
+    if (jitArea == NULL)
+        jitArea = AllocExecutableArea(JIT_AREA_SIZE);
+    if (jitAreaUsed + e.used > JIT_AREA_SIZE)
+        FlushNativeCode();
+    memcpy(jitArea + jitAreaUsed, buffer, e.used);
+    block->native = (NativeCode) (jitArea + jitAreaUsed);
+    block->nativeLength = length;
+    block->nativeAddress = virtAddr;
+    block->nativeBranch = branch + 2 == length
+                          && block->ops[branch].instr.opCode >= OP_BEQ
+                          && block->ops[branch].instr.opCode <= OP_BNE;
+    jitAreaUsed += (e.used + 15) & ~15;
+
+    DEBUG('k', "Translated %u instructions at 0x%X into %u bytes\n",
+          length, virtAddr, e.used);
+}
+
+#else
+
+/// No translator for this host: blocks are just interpreted.
+void
+Machine::CompileBlock(BasicBlock *block, unsigned virtAddr)
+{
+    ASSERT(block != NULL);
+}
+
+#endif
+
+/// Throw away all generated code, and start counting executions again.
+void
+Machine::FlushNativeCode()
+{
+    for (unsigned i = 0; i < memorySize / 4; i++)
+        if (blocks[i] != NULL) {
+            if (blocks[i]->native != NULL)
+                CountNativeRuns(blocks[i]);
+            blocks[i]->native = NULL;
+            blocks[i]->executions = 0;
+        }
+    jitAreaUsed = 0;
+}
+
+/// Return true if `opCode` is one of the loads the host code runs, which
+/// leave their register pending for the next instruction.
+static inline bool
+IsLoad(unsigned opCode)
+{
+    return opCode == OP_LB || opCode == OP_LBU || opCode == OP_LH
+           || opCode == OP_LHU || opCode == OP_LW;
+}
+
+/// The host code does not count anything itself.  What each instruction
+/// read and loaded is known from the block; whether a branch was taken is
+/// told by where it left the program counters.  Instructions run through
+/// `JitExec` were already counted by `ExecInstruction`.
+void
+Machine::CountNative(const BasicBlock *block, unsigned retired,
+                     unsigned loadReg)
+{
+    ASSERT(block != NULL);
+    ASSERT(retired <= block->nativeLength);
+
+    for (unsigned k = 0; k < retired; k++) {
+        const Instruction *instr = &block->ops[k].instr;
+        unsigned           op = instr->opCode;
+        bool               jumped = false;
+
+        if (op >= OP_BEQ && op <= OP_BNE) {
+            // A branch is only translated with its delay slot, which ends
+            // the block; the host code may stop right before the slot.
+            unsigned fallThrough = block->nativeAddress + 4 * k + 8;
+            jumped = (unsigned) registers[k + 1 == retired ? NEXT_PC_REG
+                                                           : PC_REG]
+                     != fallThrough;
+        }
+        if (op != OP_MULT && op != OP_MULTU && op != OP_DIV && op != OP_DIVU)
+            CountInstruction(instr, loadReg, jumped);
+        loadReg = IsLoad(op) ? instr->rt : 0;
+    }
+}
+
+/// Runs that started with no load pending are all alike but for the
+/// branch, which `RunBlock` tallies apart.
+void
+Machine::CountNativeRuns(BasicBlock *block)
+{
+    ASSERT(block != NULL);
+
+    unsigned loadReg = 0;
+
+    if (block->nativeRuns == 0)
+        return;
+    for (unsigned k = 0; k < block->nativeLength; k++) {
+        const Instruction *instr = &block->ops[k].instr;
+        unsigned           op = instr->opCode;
+
+        if (op != OP_MULT && op != OP_MULTU && op != OP_DIV && op != OP_DIVU)
+            CountInstruction(instr, loadReg, false, block->nativeRuns);
+        loadReg = IsLoad(op) ? instr->rt : 0;
+    }
+    stats->numBranchesTaken += block->nativeTaken;
+    block->nativeRuns = block->nativeTaken = 0;
+}
+
+void
+Machine::UpdateStatistics()
+{
+    for (unsigned i = 0; i < memorySize / 4; i++)
+        if (blocks[i] != NULL && blocks[i]->native != NULL)
+            CountNativeRuns(blocks[i]);
+}
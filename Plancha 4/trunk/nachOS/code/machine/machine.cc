@@ -9,7 +9,10 @@
 
 
 #include "machine.hh"
+#include "basic_block.hh"
+#include "instruction.hh"
 #include "threads/system.hh"
+#include "userprog/snapshot.hh"
 
 
 /// Textual names of the exceptions that can be generated by user program
@@ -52,15 +55,45 @@ CheckEndian()
 /// * `st` -- pointer to an object that performs single stepping, for
 ///   dropping into it after each user instruction is executed; if `NULL`,
 ///   execute normally, without single stepping.
-Machine::Machine(SingleStepper *st)
+/// * `threaded` -- if true, run user code with the threaded-code interpreter
+///   (see `block_sim.cc`) whenever it is not being single stepped.
+/// * `threshold` -- if not 0, blocks of the threaded-code interpreter run
+///   that many times are translated to host code (see `jit.cc`).
+/// * `numPages` -- number of physical pages of main memory.
+/// * `pageBytes` -- size of a page: a power of two, and a multiple of
+///   `SECTOR_SIZE`.
+Machine::Machine(SingleStepper *st, bool threaded, unsigned threshold,
+                 unsigned numPages, unsigned pageBytes)
 {
+    ASSERT(numPages > 0);
+    ASSERT(pageBytes % SECTOR_SIZE == 0
+           && (pageBytes & (pageBytes - 1)) == 0);
+
     for (unsigned i = 0; i < NUM_TOTAL_REGS; i++)
         registers[i] = 0;
 
-    mainMemory = new char[MEMORY_SIZE];
-    for (unsigned i = 0; i < MEMORY_SIZE; i++)
+    pageSize     = pageBytes;
+    numPhysPages = numPages;
+    memorySize   = numPages * pageBytes;
+    for (pageShift = 0; 1U << pageShift < pageSize; pageShift++)
+        ;
+
+    mainMemory = new char[memorySize];
+    for (unsigned i = 0; i < memorySize; i++)
           mainMemory[i] = 0;
 
+    decodedInstructions = new Instruction[memorySize / 4];
+    decodedValid = new bool[memorySize / 4];
+    for (unsigned i = 0; i < memorySize / 4; i++)
+        decodedValid[i] = false;
+
+    blocks = new BasicBlock *[memorySize / 4];
+    for (unsigned i = 0; i < memorySize / 4; i++)
+        blocks[i] = NULL;
+    codeGeneration = new unsigned[numPhysPages];
+    for (unsigned i = 0; i < numPhysPages; i++)
+        codeGeneration[i] = 0;
+
 #ifdef USE_TLB
     tlb = new TranslationEntry[TLB_SIZE];
     for (unsigned i = 0; i < TLB_SIZE; i++)
@@ -70,8 +103,17 @@ Machine::Machine(SingleStepper *st)
     tlb = NULL;
     pageTable = NULL;
 #endif
+    FlushSoftTlb();
 
     singleStepper = st;
+    useBlocks = threaded;
+    SelectRunMode();
+
+    // Tracing interrupts needs `OneTick` to be called for every single
+    // instruction, so there is no translating then.
+    jitThreshold = DebugIsEnabled('i') ? 0 : threshold;
+    jitArea = NULL;
+    jitAreaUsed = 0;
     CheckEndian();
 }
 
@@ -79,6 +121,12 @@ Machine::Machine(SingleStepper *st)
 Machine::~Machine()
 {
     delete [] mainMemory;
+    delete [] decodedInstructions;
+    delete [] decodedValid;
+    for (unsigned i = 0; i < memorySize / 4; i++)
+        delete blocks[i];
+    delete [] blocks;
+    delete [] codeGeneration;
     if (tlb != NULL)
         delete [] tlb;
 }
@@ -108,6 +156,47 @@ Machine::WriteRegister(unsigned num, int value)
         registers[num] = value;
 }
 
+/// Drop the cached decoded instructions of a physical page.
+///
+/// * `frame` is the physical page whose contents are about to change.
+void
+Machine::InvalidateDecodedPage(unsigned frame)
+{
+    ASSERT(frame < numPhysPages);
+
+    unsigned first = frame * pageSize / 4;
+    for (unsigned i = first; i < first + pageSize / 4; i++)
+        decodedValid[i] = false;
+    codeGeneration[frame]++;
+}
+
+void
+Machine::Save(Snapshot *snapshot) const
+{
+    ASSERT(snapshot != NULL);
+
+    snapshot->Write(registers, sizeof registers);
+    snapshot->Write(mainMemory, memorySize);
+    if (tlb != NULL)
+        snapshot->Write(tlb, TLB_SIZE * sizeof *tlb);
+}
+
+/// Everything cached from the old contents of memory and of the TLB is
+/// dropped.
+void
+Machine::Restore(Snapshot *snapshot)
+{
+    ASSERT(snapshot != NULL);
+
+    snapshot->Read(registers, sizeof registers);
+    snapshot->Read(mainMemory, memorySize);
+    if (tlb != NULL)
+        snapshot->Read(tlb, TLB_SIZE * sizeof *tlb);
+    for (unsigned i = 0; i < numPhysPages; i++)
+        InvalidateDecodedPage(i);
+    FlushSoftTlb();
+}
+
 /// Transfer control to the Nachos kernel from user mode, because the user
 /// program either invoked a system call, or some exception occured (such as
 /// the address translation failed).
@@ -28,14 +28,24 @@
 
 
 /// Definitions related to the size, and format of user memory.
+///
+/// The size of a page and the number of physical pages are chosen when the
+/// machine is created (see `Machine::pageSize`); these are the defaults.
 
-const unsigned PAGE_SIZE = SECTOR_SIZE;  ///< Set the page size equal to the
-                                         ///< disk sector size, for
-                                         ///< simplicity.
-const unsigned NUM_PHYS_PAGES = 128; 
-const unsigned MEMORY_SIZE = NUM_PHYS_PAGES * PAGE_SIZE;
+const unsigned DEFAULT_PAGE_SIZE = SECTOR_SIZE;  ///< Set the page size equal
+                                                 ///< to the disk sector
+                                                 ///< size, for simplicity.
+const unsigned DEFAULT_NUM_PHYS_PAGES = 128;
 const unsigned TLB_SIZE = 8;  ///< if there is a TLB, make it small.
 
+/// Entries in the simulator's own cache of recent translations (see
+/// `Machine::Translate`).  Must be a power of two.
+const unsigned SOFT_TLB_SIZE = 64;
+
+/// Number of times a basic block has to be run before it is translated to
+/// host code, unless some other threshold is given with `-jit`.
+const unsigned DEFAULT_JIT_THRESHOLD = 32;
+
 enum ExceptionType {
     NO_EXCEPTION,             // Everything ok!
     SYSCALL_EXCEPTION,        // A program executed a system call.
@@ -70,6 +80,36 @@ enum ExceptionType {
 #define NUM_TOTAL_REGS  40
 
 class Instruction;
+class Snapshot;
+struct BasicBlock;
+
+/// A translation that `Machine::Translate` has already checked, so that the
+/// next access to the same page needs nothing but a tag comparison.
+///
+/// This is not part of the simulated hardware: it caches whatever the TLB or
+/// page table said, and it is invisible to user programs and to statistics.
+struct SoftTlbEntry {
+    unsigned virtualPage;       ///< Tag; `SOFT_TLB_EMPTY` if unused.
+    unsigned physicalBase;      ///< Physical address of the page.
+    bool writable;              ///< False if the page is read-only.
+    TranslationEntry *entry;    ///< TLB or page table entry it comes from,
+                                ///< to keep its `use` and `dirty` bits.
+};
+
+const unsigned SOFT_TLB_EMPTY = (unsigned) -1;
+
+/// The ways `Machine::Run` can execute user code.
+///
+/// Each one is a separate instantiation of `Machine::RunLoop`, where the
+/// checks for the features it does not use are compiled out.
+enum RunMode {
+    RUN_PLAIN,     ///< One instruction at a time, and nothing else.
+    RUN_BLOCKS,    ///< Whole basic blocks at a time (`-bb` and `-jit`).
+    RUN_TRACING,   ///< One instruction at a time, printing the fetches or
+                   ///< the address translations (`-d m`, `-d a`, `-d g`).
+    RUN_STEPPING   ///< One instruction at a time, dropping into the single
+                   ///< stepper after each.
+};
 
 /// The following class defines the simulated host workstation hardware, as
 /// seen by user programs -- the CPU registers, main memory, etc.
@@ -83,12 +123,13 @@ class Instruction;
 /// able to run Nachos on top of Nachos!
 ///
 /// The procedures in this class are defined in `machine.cc`, `mipssim.cc`,
-/// and `translate.cc`.
+/// `block_sim.cc`, `jit.cc` and `translate.cc`.
 class Machine {
 public:
 
     /// Initialize the simulation of the hardware for running user programs.
-    Machine(SingleStepper *st);
+    Machine(SingleStepper *st, bool threaded, unsigned threshold,
+            unsigned numPages, unsigned pageBytes);
 
     /// De-allocate the data structures.
     ~Machine();
@@ -124,9 +165,41 @@ public:
     /// Print the user CPU and memory state.
     void DumpState();
 
+    /// Start dropping into `st` after every instruction, or stop single
+    /// stepping if `st` is `NULL`.
+    ///
+    /// Can be called at any time, even from a system call or interrupt
+    /// handler in the middle of `Run`: the new mode takes effect from the
+    /// next instruction, or from the next basic block if whole blocks were
+    /// being run.
+    void SetSingleStepper(SingleStepper *st);
+
+    /// Forget every decoded instruction cached for physical page `frame`.
+    ///
+    /// Must be called by the kernel whenever a frame is given a new
+    /// contents behind the simulator's back (freed, reassigned to another
+    /// virtual page, or filled from the executable or from swap).
+    void InvalidateDecodedPage(unsigned frame);
+
+    /// Forget every translation cached by `Translate`.
+    ///
+    /// Must be called by the kernel whenever it changes the TLB, the page
+    /// table pointer, or any entry of the page table in use.
+    void FlushSoftTlb();
+
+    /// Bring the instruction mix in `stats` up to date, before printing it.
+    void UpdateStatistics();
+
+    /// Save the registers, the TLB and physical memory to `snapshot`.
+    void Save(Snapshot *snapshot) const;
+
+    /// Load the registers, the TLB and physical memory from `snapshot`.
+    void Restore(Snapshot *snapshot);
+
     /// Routines internal to the machine simulation -- DO NOT call these.
 
-    /// Fetch one instruction of a user program.
+    /// Fetch one instruction of a user program; trace it if `TRACED`.
+    template <bool TRACED>
     bool FetchInstruction(Instruction *instr);
 
     /// Run a certain instruction of a user program.
@@ -135,6 +208,10 @@ public:
     /// Do a pending delayed load (modifying a reg).
     void DelayedLoad(unsigned nextReg, int nextVal);
 
+    /// Run the basic block at the current PC with the threaded-code
+    /// interpreter, until control leaves it.
+    void RunBlock();
+
     /// Data structures -- all of these are accessible to Nachos kernel code.
     /// “Public” for convenience.
     ///
@@ -145,6 +222,15 @@ public:
     char *mainMemory;  ///< Physical memory to store user program,
                        ///< code and data, while executing.
 
+    /// Size of main memory, and of the pages it is divided in.  Like `tlb`,
+    /// these should be considered “read-only”.
+    ///
+    /// The page size is a power of two, and a multiple of `SECTOR_SIZE`.
+
+    unsigned pageSize;
+    unsigned numPhysPages;
+    unsigned memorySize;  ///< `numPhysPages * pageSize` bytes.
+
     /// NOTE: the hardware translation of virtual addresses in the user
     /// program to physical addresses (relative to the beginning of
     /// `mainMemory`) can be controlled by one of:
@@ -179,6 +265,105 @@ private:
                                    ///< object (may be a debugger) after each
                                    ///< simulated instruction.
 
+    bool useBlocks;  ///< Run user code with the threaded-code interpreter
+                     ///< (`RunBlock`) instead of one instruction at a time.
+
+    RunMode runMode;  ///< How `Run` is to execute user code now.
+
+    /// Choose `runMode` from the single stepper, the debug flags and
+    /// `useBlocks`.
+    void SelectRunMode();
+
+    /// Execute user code the way `MODE` says, until `runMode` changes.
+    template <RunMode MODE>
+    void RunLoop(Instruction *instr);
+
+    unsigned pageShift;  ///< Base 2 logarithm of `pageSize`.
+
+    /// Return the decoded form of the word at `physicalAddress`, decoding
+    /// it first if it is not cached.
+    const Instruction *DecodedAt(unsigned physicalAddress);
+
+    /// Translate the code at `physicalAddress` into a basic block.
+    BasicBlock *BuildBlock(unsigned physicalAddress,
+                           const void *const *handlers);
+
+    /// Generate host code for `block`, whose first instruction is at
+    /// virtual address `virtAddr`.
+    void CompileBlock(BasicBlock *block, unsigned virtAddr);
+
+    /// Forget all generated host code, to reuse its memory.
+    void FlushNativeCode();
+
+    /// Add a retired instruction to the instruction mix in `stats`.
+    ///
+    /// * `loadReg` is the register loaded by the instruction before, if
+    ///   any.
+    /// * `jumped` tells whether execution goes somewhere else than the
+    ///   instruction after the delay slot.
+    /// * `times` is how many times it was retired like that.
+    void CountInstruction(const Instruction *instr, unsigned loadReg,
+                          bool jumped, unsigned long long times = 1);
+
+    /// Add the first `retired` instructions of `block` to the instruction
+    /// mix, after its host code ran them.
+    ///
+    /// * `loadReg` was `registers[LOAD_REG]` when the host code started.
+    void CountNative(const BasicBlock *block, unsigned retired,
+                     unsigned loadReg);
+
+    /// Add the runs of the host code of `block` tallied by `RunBlock` to
+    /// the instruction mix, and clear the tally.
+    void CountNativeRuns(BasicBlock *block);
+
+    /// Return true if `Translate` would succeed for these arguments,
+    /// without any of its side effects.
+    bool CanTranslate(unsigned virtAddr, unsigned size, bool writing) const;
+
+    /// Try to translate `virtAddr` with `softTlb` alone, doing what
+    /// `Translate` would on success.  Return false if it cannot be done.
+    bool TranslateCached(unsigned virtAddr, unsigned *physAddr,
+                         unsigned size, bool writing);
+
+    /// Memory accesses and complex instructions, called from generated
+    /// code.  See `jit.cc`.
+    static int JitLoad(Machine *m, unsigned addr, unsigned size,
+                       int *value);
+    static int JitStore(Machine *m, unsigned addr, unsigned size,
+                        int value);
+    static void JitExec(Machine *m, const Instruction *instr);
+
+    unsigned jitThreshold;  ///< Executions of a block before it is
+                            ///< translated to host code; 0 disables the
+                            ///< translator.
+    unsigned jitFrame;      ///< Frame of the block running as host code.
+    char *jitArea;          ///< Memory holding the generated code.
+    unsigned jitAreaUsed;   ///< Bytes of `jitArea` already in use.
+
+    /// Decoded instruction cache.
+    ///
+    /// There is one slot for every word of `mainMemory`, so slot `i` holds
+    /// the decoded form of the word at physical address `i * 4` (that is,
+    /// it is keyed by frame and offset within the frame).  A slot is only
+    /// meaningful while its `decodedValid` flag is set; stores through
+    /// `WriteMem` clear the flag of the word they touch.
+    Instruction *decodedInstructions;
+    bool *decodedValid;
+
+    /// Basic blocks for the threaded-code interpreter, indexed like
+    /// `decodedInstructions` by the physical address of their first
+    /// instruction (`NULL` where no block was ever built).
+    BasicBlock **blocks;
+
+    /// One counter per frame, bumped whenever the contents of the frame may
+    /// have changed.  A block is only valid while the counter of its frame
+    /// still has the value it had when the block was built.
+    unsigned *codeGeneration;
+
+    /// Direct-mapped cache of translations, indexed by virtual page number
+    /// modulo `SOFT_TLB_SIZE`.
+    SoftTlbEntry softTlb[SOFT_TLB_SIZE];
+
     /// Private data structures.
     int registers[NUM_TOTAL_REGS];  ///< CPU registers, for executing user
                                     ///< programs.
@@ -22,6 +22,10 @@
 ///
 /// This routine is re-entrant, in that it can be called multiple times
 /// concurrently -- one for each thread executing user code.
+///
+/// If the threaded-code interpreter was requested, whole basic blocks are
+/// run at a time, except while single stepping or tracing instructions or
+/// address translations, which need to see every fetch.
 void
 Machine::Run()
 {
@@ -29,18 +33,67 @@ Machine::Run()
       // Storage for decoded instruction.
 
     if (DebugIsEnabled('m'))
-        printf("Starting to run at time %u\n", stats->totalTicks);
+        printf("Starting to run at time %llu\n", stats->totalTicks);
     interrupt->SetStatus(USER_MODE);
 
-    for (;;) {
-        if(FetchInstruction(instr))
-        {
+    for (;;)
+        switch (runMode) {
+            case RUN_PLAIN:
+                RunLoop<RUN_PLAIN>(instr);
+                break;
+            case RUN_BLOCKS:
+                RunLoop<RUN_BLOCKS>(instr);
+                break;
+            case RUN_TRACING:
+                RunLoop<RUN_TRACING>(instr);
+                break;
+            case RUN_STEPPING:
+                RunLoop<RUN_STEPPING>(instr);
+                break;
+        }
+}
+
+/// The test of `runMode` after every instruction (or block) is the only
+/// check left in the plain and block loops: the single stepper and the
+/// debug flags are only looked at by `SelectRunMode`, whenever they may
+/// have changed.
+template <RunMode MODE>
+void
+Machine::RunLoop(Instruction *instr)
+{
+    ASSERT(instr != NULL);
+
+    do {
+        if (MODE == RUN_BLOCKS)
+            RunBlock();
+        else if (FetchInstruction<MODE != RUN_PLAIN>(instr)) {
             ExecInstruction(instr);
             interrupt->OneTick();
-            if (singleStepper != NULL && !singleStepper->Step())
-                singleStepper = NULL;
+            if (MODE == RUN_STEPPING && !singleStepper->Step())
+                SetSingleStepper(NULL);
         }
-    }
+    } while (runMode == MODE);
+}
+
+void
+Machine::SelectRunMode()
+{
+    if (singleStepper != NULL)
+        runMode = RUN_STEPPING;
+    else if (DebugIsEnabled('m') || DebugIsEnabled('a')
+               || DebugIsEnabled('g'))
+        runMode = RUN_TRACING;
+    else if (useBlocks)
+        runMode = RUN_BLOCKS;
+    else
+        runMode = RUN_PLAIN;
+}
+
+void
+Machine::SetSingleStepper(SingleStepper *st)
+{
+    singleStepper = st;
+    SelectRunMode();
 }
 
 /// Simulate effects of a delayed load.
@@ -56,19 +109,33 @@ Machine::DelayedLoad(unsigned nextReg, int nextValue)
     registers[0] = 0;  // And always make sure R0 stays zero.
 }
 
+/// Fetch the instruction at the current PC.
+///
+/// The address is always translated, so TLB statistics and page faults are
+/// exactly as if the word had been read with `ReadMem`; but the word is only
+/// read and decoded the first time it is executed from a given physical
+/// location.  Later fetches reuse the decoded copy until the word is written
+/// or its frame is reassigned (see `InvalidateDecodedPage`).
+template <bool TRACED>
 bool
 Machine::FetchInstruction(Instruction *instr)
 {
     ASSERT(instr != NULL);
 
-    int raw;
-    DEBUG('g', "Registers[PC_REG]: %d\n", registers[PC_REG]);
-    if (!ReadMem(registers[PC_REG], 4, &raw))
+    ExceptionType exception;
+    unsigned      physicalAddress;
+
+    if (TRACED)
+        DEBUG('g', "Registers[PC_REG]: %d\n", registers[PC_REG]);
+    exception = Translate(registers[PC_REG], &physicalAddress, 4, false);
+    if (exception != NO_EXCEPTION) {
+        RaiseException(exception, registers[PC_REG]);
         return false;  // Exception occurred.
-    instr->value = raw;
-    instr->Decode();
+    }
 
-    if (DebugIsEnabled('m')) {
+    *instr = *DecodedAt(physicalAddress);
+
+    if (TRACED && DebugIsEnabled('m')) {
         const struct OpString *str = &OP_STRINGS[instr->opCode];
 
         ASSERT(instr->opCode <= MAX_OPCODE);
@@ -81,6 +148,24 @@ Machine::FetchInstruction(Instruction *instr)
     return true;
 }
 
+/// Look up the word at `physicalAddress` in the decoded instruction cache,
+/// reading and decoding it from memory on a miss.
+const Instruction *
+Machine::DecodedAt(unsigned physicalAddress)
+{
+    ASSERT(physicalAddress % 4 == 0 && physicalAddress < memorySize);
+
+    unsigned     slot = physicalAddress / 4;
+    Instruction *cached = &decodedInstructions[slot];
+
+    if (!decodedValid[slot]) {
+        cached->value = WordToHost(*(unsigned *) &mainMemory[physicalAddress]);
+        cached->Decode();
+        decodedValid[slot] = true;
+    }
+    return cached;
+}
+
 /// Simulate R2000 multiplication.
 ///
 /// The words at `*hiPtr` and `*loPtr` are overwritten with the double-length
@@ -601,6 +686,8 @@ Machine::ExecInstruction(const Instruction *instr)
             break;
 
         case OP_SYSCALL:
+            // The kernel completes it, instead of restarting it.
+            CountInstruction(instr, registers[LOAD_REG], false);
             RaiseException(SYSCALL_EXCEPTION, 0);
             return;
 
@@ -623,7 +710,15 @@ Machine::ExecInstruction(const Instruction *instr)
             ASSERT(false);
     }
 
-    // Now we have successfully executed the instruction.
+    // Now we have successfully executed the instruction.  Add it to the
+    // instruction mix; same as `CountInstruction`, written out because it is
+    // done for every instruction.
+    stats->numInstructions[instr->opCode]++;
+    if (pcAfter != registers[NEXT_PC_REG] + 4
+          && instr->opCode >= OP_BEQ && instr->opCode <= OP_BNE)
+        stats->numBranchesTaken++;
+    if (instr->sources >> registers[LOAD_REG] & 1)
+        stats->numLoadUses++;
 
     // Do any delayed load operation.
     DelayedLoad(nextLoadReg, nextLoadValue);
@@ -634,3 +729,18 @@ Machine::ExecInstruction(const Instruction *instr)
     registers[PC_REG] = registers[NEXT_PC_REG];
     registers[NEXT_PC_REG] = pcAfter;
 }
+
+/// A few counters, and a look at the registers the instruction reads.
+void
+Machine::CountInstruction(const Instruction *instr, unsigned loadReg,
+                          bool jumped, unsigned long long times)
+{
+    ASSERT(instr != NULL);
+
+    stats->numInstructions[instr->opCode] += times;
+    if (jumped && instr->opCode >= OP_BEQ && instr->opCode <= OP_BNE)
+        stats->numBranchesTaken += times;  // Conditional branches are
+                                           // contiguous.
+    if (instr->sources >> loadReg & 1)
+        stats->numLoadUses += times;
+}
@@ -22,6 +22,14 @@ NetworkReadPoll(void *arg)
     net->CheckPktAvail();
 }
 
+static void
+NetworkInputReady(void *arg)
+{
+    ASSERT(arg != NULL);
+    Network *net = (Network *) arg;
+    net->InputReady();
+}
+
 static void
 NetworkSendDone(void *arg)
 {
@@ -62,33 +70,39 @@ Network::Network(NetworkAddress addr, double reliability,
     AssignNameToSocket(sockName, sock);     // Bind socket to a filename in the
                      // current directory.
 
-    // Start polling for incoming packets.
-    interrupt->Schedule(NetworkReadPoll, this,
-                        NETWORK_TIME, NETWORK_RECV_INT);
+    // Wait for the first packet.
+    WatchFile(sock, NetworkInputReady, this);
 }
 
 Network::~Network()
 {
+    UnwatchFile(sock);
     CloseSocket(sock);
     DeAssignNameToSocket(sockName);
 }
 
+/// Called when the host has a packet waiting on the socket: it arrives
+/// after the time it takes to receive one.
+void
+Network::InputReady()
+{
+    interrupt->Schedule(NetworkReadPoll, this,
+                        NETWORK_TIME, NETWORK_RECV_INT);
+}
+
 /// If a packet is already buffered, we simply delay reading the incoming
 /// packet.  In real life, the incoming packet might be dropped if we cannot
 /// read it in time.
 void
 Network::CheckPktAvail()
 {
-    // Schedule the next time to poll for a packet.
-    interrupt->Schedule(NetworkReadPoll, this,
-                        NETWORK_TIME, NETWORK_RECV_INT);
-
-    if (inHdr.length != 0)  // Do nothing if packet is already buffered.
-        return;
-    if (!PollSocket(sock))  // Do nothing if no packet to be read.
+    if (inHdr.length != 0) {  // Try later if a packet is already buffered.
+        interrupt->Schedule(NetworkReadPoll, this,
+                            NETWORK_TIME, NETWORK_RECV_INT);
         return;
+    }
 
-    // Otherwise, read packet in.
+    // Otherwise, read packet in, and wait for the next one.
     char *buffer = new char[MAX_WIRE_SIZE];
     ReadFromSocket(sock, buffer, MAX_WIRE_SIZE);
 
@@ -97,6 +111,7 @@ Network::CheckPktAvail()
     ASSERT(inHdr.to == ident && inHdr.length <= MAX_PACKET_SIZE);
     memcpy(inbox, buffer + sizeof (PacketHeader), inHdr.length);
     delete [] buffer;
+    WatchFile(sock, NetworkInputReady, this);
 
     DEBUG('n', "Network received packet from %d, length %u...\n",
           (int) inHdr.from, inHdr.length);
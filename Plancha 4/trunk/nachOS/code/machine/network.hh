@@ -92,6 +92,9 @@ public:
     /// Check if there is an incoming packet.
     void CheckPktAvail();
 
+    /// Called when the host socket has a packet to be read.
+    void InputReady();
+
 private:
 
     /// This machine's network address.
@@ -12,6 +12,23 @@
 #include "lib/utility.hh"
 
 
+#ifdef USER_PROGRAM
+/// Opcodes of the loads and stores of each size, and of the conditional
+/// branches.
+static const int LOADS_1[]  = { OP_LB, OP_LBU };
+static const int LOADS_2[]  = { OP_LH, OP_LHU };
+static const int LOADS_4[]  = { OP_LW, OP_LWL, OP_LWR };
+static const int STORES_1[] = { OP_SB };
+static const int STORES_2[] = { OP_SH };
+static const int STORES_4[] = { OP_SW, OP_SWL, OP_SWR };
+static const int BRANCHES[] = {
+    OP_BEQ, OP_BGEZ, OP_BGEZAL, OP_BGTZ, OP_BLEZ, OP_BLTZ, OP_BLTZAL, OP_BNE
+};
+
+#define LENGTH(a)  (sizeof (a) / sizeof *(a))
+#endif
+
+
 /// Initialize performance metrics to zero, at system startup.
 Statistics::Statistics()
 {
@@ -19,12 +36,15 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
-#ifdef DFS_TICKS_FIX
-    tickResets = 0;
-#endif
     #ifdef USE_TLB
     numHit = numMiss = 0;
     #endif
+#ifdef USER_PROGRAM
+    for (unsigned i = 0; i <= MAX_OPCODE; i++)
+        numInstructions[i] = 0;
+    numBranchesTaken = numLoadUses = 0;
+    jsonFile = NULL;
+#endif
 }
 
 /// Print performance metrics, when we have finished everything at system
@@ -32,12 +52,7 @@ Statistics::Statistics()
 void
 Statistics::Print()
 {
-#ifdef DFS_TICKS_FIX
-    if (tickResets != 0)
-        printf("WARNING: the tick counter was reset %lu times; the following"
-               " statistics may be invalid.\n\n", tickResets);
-#endif
-    printf("Ticks: total %u, idle %u, system %u, user %u\n",
+    printf("Ticks: total %llu, idle %llu, system %llu, user %llu\n",
            totalTicks, idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %u, writes %u\n", numDiskReads, numDiskWrites);
     printf("Console I/O: reads %u, writes %u\n",
@@ -50,4 +65,86 @@ Statistics::Print()
     float hitRatio = (numHit * 100) / (float)numAccess; //Calculamos porcentaje de hit
     printf("Total access: %u, Hit Ratio: %f\n", numAccess, hitRatio);
     #endif
+#ifdef USER_PROGRAM
+    unsigned long long branches = CountOf(BRANCHES, LENGTH(BRANCHES));
+    printf("User memory ops: loads %llu/%llu/%llu, stores %llu/%llu/%llu "
+           "(1/2/4 bytes)\n",
+           CountOf(LOADS_1, LENGTH(LOADS_1)),
+           CountOf(LOADS_2, LENGTH(LOADS_2)),
+           CountOf(LOADS_4, LENGTH(LOADS_4)),
+           CountOf(STORES_1, LENGTH(STORES_1)),
+           CountOf(STORES_2, LENGTH(STORES_2)),
+           CountOf(STORES_4, LENGTH(STORES_4)));
+    printf("User branches: %llu, taken %llu (%.1f%%), load uses %llu\n",
+           branches, numBranchesTaken,
+           branches == 0 ? 0.0 : 100.0 * numBranchesTaken / branches,
+           numLoadUses);
+    if (jsonFile != NULL)
+        WriteJson();
+#endif
+}
+
+#ifdef USER_PROGRAM
+unsigned long long
+Statistics::CountOf(const int *opCodes, unsigned count) const
+{
+    ASSERT(opCodes != NULL);
+
+    unsigned long long sum = 0;
+    for (unsigned i = 0; i < count; i++)
+        sum += numInstructions[opCodes[i]];
+    return sum;
+}
+
+/// The instruction mix is an object with one member per opcode that was
+/// executed at all, named after the instruction.
+void
+Statistics::WriteJson() const
+{
+    FILE *f = fopen(jsonFile, "w");
+
+    if (f == NULL) {
+        printf("Unable to open %s\n", jsonFile);
+        return;
+    }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"ticks\": {\"total\": %llu, \"idle\": %llu, "
+               "\"system\": %llu, \"user\": %llu},\n",
+            totalTicks, idleTicks, systemTicks, userTicks);
+    fprintf(f, "  \"disk\": {\"reads\": %u, \"writes\": %u},\n",
+            numDiskReads, numDiskWrites);
+    fprintf(f, "  \"console\": {\"reads\": %u, \"writes\": %u},\n",
+            numConsoleCharsRead, numConsoleCharsWritten);
+    fprintf(f, "  \"pageFaults\": %u,\n", numPageFaults);
+    fprintf(f, "  \"network\": {\"received\": %u, \"sent\": %u},\n",
+            numPacketsRecvd, numPacketsSent);
+    #ifdef USE_TLB
+    fprintf(f, "  \"tlb\": {\"hits\": %u, \"misses\": %u},\n",
+            numHit, numMiss);
+    #endif
+    fprintf(f, "  \"loads\": {\"1\": %llu, \"2\": %llu, \"4\": %llu},\n",
+            CountOf(LOADS_1, LENGTH(LOADS_1)),
+            CountOf(LOADS_2, LENGTH(LOADS_2)),
+            CountOf(LOADS_4, LENGTH(LOADS_4)));
+    fprintf(f, "  \"stores\": {\"1\": %llu, \"2\": %llu, \"4\": %llu},\n",
+            CountOf(STORES_1, LENGTH(STORES_1)),
+            CountOf(STORES_2, LENGTH(STORES_2)),
+            CountOf(STORES_4, LENGTH(STORES_4)));
+    fprintf(f, "  \"branches\": {\"executed\": %llu, \"taken\": %llu},\n",
+            CountOf(BRANCHES, LENGTH(BRANCHES)), numBranchesTaken);
+    fprintf(f, "  \"loadUses\": %llu,\n", numLoadUses);
+    fprintf(f, "  \"instructions\": {");
+    const char *separator = "";
+    for (unsigned i = 0; i <= MAX_OPCODE; i++) {
+        if (numInstructions[i] == 0)
+            continue;
+        // The name is the start of the format used to print instructions.
+        const char *name = OP_STRINGS[i].string;
+        fprintf(f, "%s\n    \"%.*s\": %llu", separator,
+                (int) strcspn(name, " "), name, numInstructions[i]);
+        separator = ",";
+    }
+    fprintf(f, "\n  }\n}\n");
+    fclose(f);
 }
+#endif
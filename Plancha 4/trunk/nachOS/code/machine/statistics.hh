@@ -11,6 +11,17 @@
 #define NACHOS_MACHINE_STATS__HH
 
 
+#include "encoding.hh"
+
+#include <limits.h>
+
+
+/// Simulated time.  64 bits, so that the counter never wraps around in
+/// practice.
+typedef unsigned long long Ticks;
+
+const Ticks TICKS_MAX = ULLONG_MAX;
+
 /// The following class defines the statistics that are to be kept about
 /// Nachos behavior -- how much time (ticks) elapsed, how many user
 /// instructions executed, etc.
@@ -20,17 +31,17 @@ class Statistics {
 public:
 
     /// Total time running Nachos.
-    unsigned totalTicks;
+    Ticks totalTicks;
 
     /// Time spent idle (no threads to run).
-    unsigned idleTicks;
+    Ticks idleTicks;
 
     /// Time spent executing system code.
-    unsigned systemTicks;
+    Ticks systemTicks;
 
     /// Time spent executing user code (this is also equal to # of user
     /// instructions executed).
-    unsigned userTicks;
+    Ticks userTicks;
 
     /// Number of disk read requests.
     unsigned numDiskReads;
@@ -53,21 +64,43 @@ public:
     /// Number of packets received over the network.
     unsigned numPacketsRecvd;
 
-#ifdef DFS_TICKS_FIX
-    /// Number of times the tick count gets reset.
-    unsigned long tickResets;
-#endif
-
     #ifdef USE_TLB
     unsigned numHit;
     unsigned numMiss;
     #endif
 
+#ifdef USER_PROGRAM
+    /// User instructions retired, by opcode (see `encoding.hh`).  Loads and
+    /// stores of each size are counted here too, by their opcodes.
+    unsigned long long numInstructions[MAX_OPCODE + 1];
+
+    /// Conditional branches that were taken; how many were executed in all
+    /// is in `numInstructions`.
+    unsigned long long numBranchesTaken;
+
+    /// Instructions that read the register loaded by the instruction right
+    /// before them.  The R2000 does not wait for the load, and they see the
+    /// old value; later processors stall for a cycle.
+    unsigned long long numLoadUses;
+
+    /// File to write everything to, as JSON, when printing; `NULL` if none.
+    const char *jsonFile;
+#endif
+
     /// Initialize everything to zero.
     Statistics();
 
     /// Print collected statistics.
     void Print();
+
+private:
+#ifdef USER_PROGRAM
+    /// Sum of `numInstructions` over `count` opcodes.
+    unsigned long long CountOf(const int *opCodes, unsigned count) const;
+
+    /// Write all the statistics to `jsonFile`.
+    void WriteJson() const;
+#endif
 };
 
 /// Constants used to reflect the relative time an operation would take in a
@@ -93,6 +126,8 @@ const unsigned NETWORK_TIME  = 100;
   ///< Time to send or receive one packet.
 const unsigned TIMER_TICKS   = 100;
   ///< (Average) time between timer interrupts.
+const unsigned HOST_POLL_TIME = 100;
+  ///< Time between checks for host input, while not idle.
 
 
 #endif
@@ -41,8 +41,10 @@ extern "C" {
 #endif
 #ifdef HOST_LINUX
 #include <sys/syscall.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 #endif
+#include <errno.h>
 
 /// UNIX routines called by procedures in this file
 
@@ -55,42 +57,136 @@ extern "C" {
 }
 
 
-///     Check open file or open socket to see if there are any
-///     characters that can be read immediately.  If so, read them
-///     in, and return TRUE.
-///
-///     In the network case, if there are no threads for us to run,
-///     and no characters to be read,
-///     we need to give the other side a chance to get our host's CPU
-///     (otherwise, we will go really slowly, since UNIX time-slices
-///     infrequently, and this would be like busy-waiting).  So we
-///     delay for a short fixed time, before allowing ourselves to be
-///     re-scheduled (sort of like a Yield, but cast in terms of UNIX).
-///
-///     "fd" -- the file descriptor of the file to be polled
-bool
-PollFile(int fd)
+/// A host file that a device waits on for input.
+struct HostWatch {
+    int fd;                   ///< -1 if the entry is free.
+    VoidFunctionPtr handler;  ///< What to call when there is input.
+    void *arg;                ///< Argument to pass to `handler`.
+    bool armed;               ///< Set until `handler` has been called.
+    bool pollable;            ///< False for regular files, which `epoll`
+                              ///< refuses; they are always ready.
+};
+
+static const unsigned MAX_HOST_WATCHES = 8;
+
+static HostWatch hostWatches[MAX_HOST_WATCHES];
+static unsigned numHostWatches;  ///< Entries of `hostWatches` ever used.
+static int epollFd = -1;
+
+/// Watches are one-shot (`EPOLLONESHOT`), so that input left on the file
+/// is not reported over and over.
+void
+WatchFile(int fd, VoidFunctionPtr handler, void *arg)
 {
-    int            rfd = (1 << fd), wfd = 0, xfd = 0, retVal;
-    struct timeval pollTime;
+    ASSERT(fd >= 0);
+    ASSERT(handler != NULL);
+
+    unsigned i, free = MAX_HOST_WATCHES;
+    for (i = 0; i < numHostWatches && hostWatches[i].fd != fd; i++)
+        if (hostWatches[i].fd == -1 && free == MAX_HOST_WATCHES)
+            free = i;
+    bool renew = i < numHostWatches;
+    if (!renew) {
+        if (free == MAX_HOST_WATCHES) {
+            ASSERT(numHostWatches < MAX_HOST_WATCHES);
+            free = numHostWatches++;
+        }
+        i = free;
+        hostWatches[i].fd = fd;
+        hostWatches[i].pollable = true;
+    }
 
-    // Decide how long to wait if there are no characters on the file.
-    pollTime.tv_sec = 0;
-    if (interrupt->GetStatus() == IDLE_MODE)
-        pollTime.tv_usec = 20000;  // Delay to let other nachos run.
-    else
-        pollTime.tv_usec = 0;      // No delay.
+    HostWatch *w = &hostWatches[i];
+    w->handler = handler;
+    w->arg     = arg;
+    w->armed   = true;
+    if (!w->pollable)
+        return;
 
-    // Poll file or socket.
-#ifdef HOST_LINUX
-    retVal = select(32, (fd_set *) &rfd, (fd_set *) &wfd, (fd_set *) &xfd,
-                    &pollTime);
-#else
-    retVal = select(32, &rfd, &wfd, &xfd, &pollTime);
-#endif
+    if (epollFd == -1) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        ASSERT(epollFd >= 0);
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof event);
+    event.events   = EPOLLIN | EPOLLONESHOT;
+    event.data.u32 = i;
+    if (epoll_ctl(epollFd, renew ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                  fd, &event) == 0)
+        return;
+    ASSERT(!renew && errno == EPERM);
+    w->pollable = false;
+}
+
+void
+UnwatchFile(int fd)
+{
+    for (unsigned i = 0; i < numHostWatches; i++)
+        if (hostWatches[i].fd == fd) {
+            if (hostWatches[i].pollable)
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+            hostWatches[i].fd = -1;
+        }
+}
 
-    ASSERT(retVal == 0 || retVal == 1);
-    return retVal;  // If 0, no char waiting to be read.
+/// A regular file always has input, or is at its end, so its handler is
+/// called without asking the host, and then nothing waits.
+bool
+PollHostFiles(bool wait)
+{
+    VoidFunctionPtr handlers[MAX_HOST_WATCHES];
+    void           *args[MAX_HOST_WATCHES];
+    unsigned        numHandlers = 0;
+
+    // An event can be left over from a file no longer watched; then wait
+    // again.
+    do {
+        bool anyArmed = false, anyReady = false;
+        for (unsigned i = 0; i < numHostWatches; i++)
+            if (hostWatches[i].fd != -1 && hostWatches[i].armed) {
+                anyArmed = true;
+                anyReady = anyReady || !hostWatches[i].pollable;
+            }
+        if (!anyArmed)
+            return false;
+
+        struct epoll_event events[MAX_HOST_WATCHES];
+        int numEvents = 0;
+        if (epollFd != -1) {
+            int timeout = wait && !anyReady ? -1 : 0;
+            while ((numEvents = epoll_wait(epollFd, events, MAX_HOST_WATCHES,
+                                           timeout)) < 0) {
+                ASSERT(errno == EINTR);
+                if (timeout == 0) {
+                    numEvents = 0;
+                    break;
+                }
+            }
+        }
+
+        // Handlers may watch files again, so they are only called once
+        // every entry reported has been disarmed.
+        for (int e = 0; e < numEvents; e++) {
+            HostWatch *w = &hostWatches[events[e].data.u32];
+            if (w->fd == -1 || !w->armed)
+                continue;
+            w->armed = false;
+            handlers[numHandlers] = w->handler;
+            args[numHandlers++]   = w->arg;
+        }
+        for (unsigned i = 0; i < numHostWatches; i++) {
+            HostWatch *w = &hostWatches[i];
+            if (w->fd != -1 && w->armed && !w->pollable) {
+                w->armed = false;
+                handlers[numHandlers] = w->handler;
+                args[numHandlers++]   = w->arg;
+            }
+        }
+    } while (wait && numHandlers == 0);
+
+    for (unsigned i = 0; i < numHandlers; i++)
+        (*handlers[i])(args[i]);
+    return numHandlers > 0;
 }
 
 /// Open a file for writing.
@@ -255,13 +351,6 @@ DeAssignNameToSocket(const char *socketName)
     unlink(socketName);
 }
 
-/// Return true if there are any messages waiting to arrive on the IPC port.
-bool
-PollSocket(int sockID)
-{
-    return PollFile(sockID);  // On UNIX, socket ID's are just file ID's.
-}
-
 /// Read a fixed size packet off the IPC port.
 ///
 /// Abort on error.
@@ -353,27 +442,36 @@ Random()
 }
 
 /// Return an array, with the two pages just before and after the array
-/// unmapped, to catch illegal references off the end of the array.
+/// made inaccessible, to catch illegal references off the end of the array.
 /// Particularly useful for catching overflow beyond fixed-size thread
 /// execution stacks.
 ///
+/// The array is mapped on its own, so that the guard pages do not share a
+/// page with anything else; `size` is rounded up to whole pages, so only
+/// the end of an array of whole pages is guarded exactly.
+///
 /// Note: Just return the useful part!
 ///
 /// * `size` -- amount of useful space needed (in bytes).
 char *
 AllocBoundedArray(unsigned size)
 {
-    int   pgSize = getpagesize();
-    char *ptr    = new char[pgSize * 2 + size];
+    ASSERT(size > 0);
 
-#ifndef HOST_LINUX
-    mprotect(ptr, pgSize, 0);
-    mprotect(ptr + pgSize + size, pgSize, 0);
-#endif
+    int      pgSize = getpagesize();
+    unsigned length = divRoundUp(size, pgSize) * pgSize;
+    char    *ptr    = (char *) mmap(NULL, pgSize * 2 + length,
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    ASSERT(ptr != MAP_FAILED);
+    mprotect(ptr, pgSize, PROT_NONE);
+    mprotect(ptr + pgSize + length, pgSize, PROT_NONE);
     return ptr + pgSize;
 }
 
-/// Deallocate an array of integers, unprotecting its two boundary pages.
+/// Deallocate an array allocated by `AllocBoundedArray`, with its two
+/// boundary pages.
 ///
 /// * `ptr` is the array to be deallocated.
 /// * `size` is the amount of useful space in the array (in bytes).
@@ -383,11 +481,22 @@ DeallocBoundedArray(const char *ptr, unsigned size)
     ASSERT(ptr != NULL);
     ASSERT(size > 0);
 
-    int pgSize = getpagesize();
+    int      pgSize = getpagesize();
+    unsigned length = divRoundUp(size, pgSize) * pgSize;
 
-#ifndef HOST_LINUX
-    mprotect(ptr - pgSize, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-    mprotect(ptr + size,   pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-#endif
-    delete [] (ptr - pgSize);
+    munmap((void *) (ptr - pgSize), pgSize * 2 + length);
+}
+
+/// Map `size` bytes that are readable, writable and executable.
+///
+/// * `size` -- amount of space needed (in bytes).
+char *
+AllocExecutableArea(unsigned size)
+{
+    ASSERT(size > 0);
+
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT(ptr != MAP_FAILED);
+    return (char *) ptr;
 }
@@ -16,10 +16,22 @@
 #include <stddef.h>
 
 
-/// Check file to see if there are any characters to be read.
+/// Wait for input on host file `fd`: the next call to `PollHostFiles` that
+/// finds something to read, or end of file, calls `handler` with `arg`.
 ///
-/// If no characters in the file, return without waiting.
-extern bool PollFile(int fd);
+/// The watch is then over, so that a device can leave the input on the file
+/// until it is ready for more; calling `WatchFile` again renews it.
+extern void WatchFile(int fd, VoidFunctionPtr handler, void *arg);
+
+/// Stop watching `fd`, which must be done before closing it.
+extern void UnwatchFile(int fd);
+
+/// Call the handlers of the watched files that have input.
+///
+/// If `wait` is set, block until there is some.  Return false, without
+/// waiting, if no file is being watched; otherwise, true if some handler
+/// was called.
+extern bool PollHostFiles(bool wait);
 
 /// File operations: `open`/`read`/`write`/`lseek`/`close`, and check for
 /// error.
@@ -54,8 +66,6 @@ extern void AssignNameToSocket(const char *socketName, int sockID);
 
 extern void DeAssignNameToSocket(const char *socketName);
 
-extern bool PollSocket(int sockID);
-
 extern void ReadFromSocket(int sockID, char *buffer, size_t packetSize);
 
 extern void SendToSocket(int sockID, const char *buffer,
@@ -81,6 +91,10 @@ extern char *AllocBoundedArray(unsigned size);
 
 extern void DeallocBoundedArray(const char *p, unsigned size);
 
+/// Allocate memory that host code can be written into and then executed
+/// (for the dynamic translator).  It is never given back.
+extern char *AllocExecutableArea(unsigned size);
+
 /// Other C library routines that are used by Nachos.
 /// These are assumed to be portable, so we do not include a wrapper.
 extern "C" {
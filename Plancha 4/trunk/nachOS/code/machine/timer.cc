@@ -47,12 +47,38 @@ Timer::Timer(VoidFunctionPtr timerHandler, void *callArg, bool doRandom)
     randomize = doRandom;
     handler   = timerHandler;
     arg       = callArg;
+    running   = false;
 
-    // Schedule the first interrupt from the timer device.
+    Start();  // Schedule the first interrupt from the timer device.
+}
+
+void
+Timer::Start()
+{
+    if (running)
+        return;
+    running = true;
     interrupt->Schedule(TimerHandler, this, TimeOfNextInterrupt(),
                         TIMER_INT);
 }
 
+/// Can be called from the interrupt handler, after `TimerExpired` has
+/// scheduled the next interrupt.
+void
+Timer::Stop()
+{
+    if (!running)
+        return;
+    running = false;
+    interrupt->Cancel(TIMER_INT);
+}
+
+bool
+Timer::IsRunning() const
+{
+    return running;
+}
+
 /// Routine to simulate the interrupt generated by the hardware timer device.
 ///
 /// Schedule the next interrupt, and invoke the interrupt handler.
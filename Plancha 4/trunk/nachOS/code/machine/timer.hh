@@ -10,6 +10,9 @@
 /// In order to introduce some randomness into time-slicing, if `doRandom` is
 /// set, then the interrupt comes after a random number of ticks.
 ///
+/// The timer can be stopped and started again, so that a kernel with
+/// nothing to time-slice between need not take its interrupts.
+///
 /// DO NOT CHANGE -- part of the machine emulation
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
@@ -34,6 +37,16 @@ public:
 
     ~Timer() {}
 
+    /// Start interrupting every time slice again, after `Stop`.  Does
+    /// nothing if the timer is running.
+    void Start();
+
+    /// Stop interrupting, cancelling the interrupt already scheduled.
+    void Stop();
+
+    /// Return true unless the timer has been stopped.
+    bool IsRunning() const;
+
     /// Internal routines to the timer emulation -- DO NOT call these.
 
     /// Called internally when the hardware timer generates an interrupt.
@@ -44,6 +57,7 @@ public:
 
 private:
     bool randomize;  ///< Set if we need to use a random timeout delay.
+    bool running;  ///< Set while an interrupt is scheduled.
     VoidFunctionPtr handler;  ///< Timer interrupt handler.
     void *arg;  ///< Argument to pass to interrupt handler.
 
@@ -96,12 +96,14 @@ Machine::ReadMem(unsigned addr, unsigned size, int *value)
     ExceptionType exception;
     unsigned      physicalAddress;
 
-    DEBUG('a', "Reading VA 0x%X, size %u\n", addr, size);
+    if (!TranslateCached(addr, &physicalAddress, size, false)) {
+        DEBUG('a', "Reading VA 0x%X, size %u\n", addr, size);
 
-    exception = Translate(addr, &physicalAddress, size, false);
-    if (exception != NO_EXCEPTION) {
-        RaiseException(exception, addr);
-        return false;
+        exception = Translate(addr, &physicalAddress, size, false);
+        if (exception != NO_EXCEPTION) {
+            RaiseException(exception, addr);
+            return false;
+        }
     }
     switch (size) {
         case 1:
@@ -141,12 +143,15 @@ Machine::WriteMem(unsigned addr, unsigned size, int value)
     ExceptionType exception;
     unsigned      physicalAddress;
 
-    DEBUG('a', "Writing VA 0x%X, size %u, value 0x%X\n", addr, size, value);
+    if (!TranslateCached(addr, &physicalAddress, size, true)) {
+        DEBUG('a', "Writing VA 0x%X, size %u, value 0x%X\n",
+              addr, size, value);
 
-    exception = Translate(addr, &physicalAddress, size, true);
-    if (exception != NO_EXCEPTION) {
-        RaiseException(exception, addr);
-        return false;
+        exception = Translate(addr, &physicalAddress, size, true);
+        if (exception != NO_EXCEPTION) {
+            RaiseException(exception, addr);
+            return false;
+        }
     }
     switch (size) {
         case 1:
@@ -167,10 +172,50 @@ Machine::WriteMem(unsigned addr, unsigned size, int value)
         default:
             ASSERT(false);
     }
+    decodedValid[physicalAddress / 4] = false;  // The word may be code.
+    codeGeneration[physicalAddress >> pageShift]++;
+
+    return true;
+}
+
+/// Look `virtAddr` up in the software translation cache.
+///
+/// On a hit, do everything a successful `Translate` would: count a TLB hit,
+/// set the use/dirty bits of the entry the translation came from, and store
+/// the physical address in `physAddr`.  A miss, a misaligned access or a
+/// write to a read-only page return false and change nothing, so that the
+/// caller can go through `Translate` and get the very same outcome as if
+/// there were no cache.
+inline bool
+Machine::TranslateCached(unsigned virtAddr, unsigned *physAddr,
+                         unsigned size, bool writing)
+{
+    unsigned      vpn = virtAddr >> pageShift;
+    SoftTlbEntry *cached = &softTlb[vpn % SOFT_TLB_SIZE];
+
+    if (cached->virtualPage != vpn || virtAddr & (size - 1)
+          || (writing && !cached->writable))
+        return false;
 
+#ifdef USE_TLB
+    if (tlb != NULL)
+        stats->numHit++;
+#endif
+    cached->entry->use = true;
+    if (writing)
+        cached->entry->dirty = true;
+    *physAddr = cached->physicalBase + (virtAddr & (pageSize - 1));
     return true;
 }
 
+/// Empty the software translation cache.
+void
+Machine::FlushSoftTlb()
+{
+    for (unsigned i = 0; i < SOFT_TLB_SIZE; i++)
+        softTlb[i].virtualPage = SOFT_TLB_EMPTY;
+}
+
 /// Translate a virtual address into a physical address, using
 /// either a page table or a TLB.
 ///
@@ -179,6 +224,11 @@ Machine::WriteMem(unsigned addr, unsigned size, int value)
 /// translated physical address in "physAddr".  If there was an error,
 /// returns the type of the exception.
 ///
+/// Successful translations are remembered in `softTlb`, so that later
+/// accesses to the same page skip the checks and the TLB search.  While
+/// address translations are being traced nothing is remembered, so that
+/// every access is still printed.
+///
 /// * `virtAddr" is the virtual address to translate.
 /// * `physAddr" is the place to store the physical address.
 /// * `size" is the amount of memory being read or written.
@@ -189,6 +239,9 @@ Machine::Translate(unsigned virtAddr, unsigned *physAddr,
 {
     ASSERT(physAddr != NULL);
 
+    if (TranslateCached(virtAddr, physAddr, size, writing))
+        return NO_EXCEPTION;
+
     unsigned          i, vpn, offset, pageFrame;
     TranslationEntry *entry;
 
@@ -208,8 +261,8 @@ Machine::Translate(unsigned virtAddr, unsigned *physAddr,
 
     // Calculate the virtual page number, and offset within the page,
     // from the virtual address.
-    vpn    = (unsigned) virtAddr / PAGE_SIZE;
-    offset = (unsigned) virtAddr % PAGE_SIZE;
+    vpn    = (unsigned) virtAddr >> pageShift;
+    offset = (unsigned) virtAddr & (pageSize - 1);
 
     if (tlb == NULL) {        // => page table => `vpn` is index into table.
         if (vpn >= pageTableSize) {
@@ -258,15 +311,54 @@ Machine::Translate(unsigned virtAddr, unsigned *physAddr,
 
     // If the `pageFrame` is too big, there is something really wrong!  An
     // invalid translation was loaded into the page table or TLB.
-    if (pageFrame >= NUM_PHYS_PAGES) {
-        DEBUG_CONT('a', "frame %u > %u!\n", pageFrame, NUM_PHYS_PAGES);
+    if (pageFrame >= numPhysPages) {
+        DEBUG_CONT('a', "frame %u > %u!\n", pageFrame, numPhysPages);
         return BUS_ERROR_EXCEPTION;
     }
     entry->use = true;  // Set the `use`, `dirty` bits.
     if (writing)
         entry->dirty = true;
-    *physAddr = pageFrame * PAGE_SIZE + offset;
-    ASSERT(*physAddr >= 0 && *physAddr + size <= MEMORY_SIZE);
+    *physAddr = pageFrame * pageSize + offset;
+    ASSERT(*physAddr >= 0 && *physAddr + size <= memorySize);
     DEBUG_CONT('a', "physical address = 0x%X\n", *physAddr);
+
+    if (!DebugIsEnabled('a')) {
+        SoftTlbEntry *cached = &softTlb[vpn % SOFT_TLB_SIZE];
+        cached->virtualPage  = vpn;
+        cached->physicalBase = pageFrame * pageSize;
+        cached->writable     = !entry->readOnly;
+        cached->entry        = entry;
+    }
     return NO_EXCEPTION;
 }
+
+/// Check whether `Translate` would succeed, without raising anything,
+/// counting TLB hits or misses, or setting the use and dirty bits.
+///
+/// Used by the dynamic translator to find out beforehand whether a memory
+/// access would trap, and let the interpreter perform it if so.
+bool
+Machine::CanTranslate(unsigned virtAddr, unsigned size, bool writing) const
+{
+    const TranslationEntry *entry = NULL;
+    unsigned                vpn = virtAddr >> pageShift;
+    const SoftTlbEntry     *cached = &softTlb[vpn % SOFT_TLB_SIZE];
+
+    if (cached->virtualPage == vpn && !(virtAddr & (size - 1))
+          && (cached->writable || !writing))
+        return true;
+
+    if ((size == 4 && virtAddr & 0x3) || (size == 2 && virtAddr & 0x1))
+        return false;
+
+    if (tlb == NULL) {
+        if (vpn < pageTableSize && pageTable[vpn].valid)
+            entry = &pageTable[vpn];
+    } else {
+        for (unsigned i = 0; i < TLB_SIZE && entry == NULL; i++)
+            if (tlb[i].valid && tlb[i].virtualPage == vpn)
+                entry = &tlb[i];
+    }
+    return entry != NULL && !(entry->readOnly && writing)
+           && entry->physicalPage < numPhysPages;
+}
@@ -0,0 +1,190 @@
+/// Latency test for priority donation.
+///
+/// A thread of high priority waits for a lock held by one of low priority,
+/// while a thread of medium priority has work to do.  Unless the low thread
+/// is lent the high priority, the medium one runs first, and the high one
+/// waits for all of its work: an inversion of priorities.  Two cases are
+/// tried:
+///
+/// * A chain: the high thread waits for a lock held by a middle thread,
+///   which in turn waits for a lock held by the low one.
+/// * Several held locks: the low thread holds two locks, the high thread
+///   waits for the second one, and releasing the first one must not take
+///   away the priority it was lent through the second.
+///
+/// For every case, the test reports the longest and the mean time the high
+/// thread waited for its lock.  It is meant for the `priority` policy with
+/// `-dt`, under which a thread is never preempted by one of lower priority.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "synch.hh"
+#include "system.hh"
+
+
+/// Priorities of the threads, above the levels of the feedback queue so
+/// that `mlfq` leaves them alone.
+static const int LOW_PRIORITY    = MAX_PRIORITY - 4;
+static const int MIDDLE_PRIORITY = MAX_PRIORITY - 3;
+static const int MEDIUM_PRIORITY = MAX_PRIORITY - 2;
+static const int HIGH_PRIORITY   = MAX_PRIORITY - 1;
+
+/// Ticks of work the low thread does with each lock held, and the medium
+/// thread does in all.
+static const Ticks HOLD_TICKS = 2 * TIMER_TICKS;
+static const Ticks WORK_TICKS = 20 * TIMER_TICKS;
+
+/// Whether this round tries a chain, rather than several held locks.
+static bool chain;
+
+/// The locks: `first` and `second` are held by the low thread, except that
+/// in a chain `second` is held by the middle thread instead.
+static Lock *first, *second;
+
+/// Signalled by every thread once it holds its locks, and by the test to
+/// let the low thread go on.
+static Semaphore *ready, *go;
+
+/// Ticks the high thread waited in this round.
+static Ticks waited;
+
+/// Do `ticks` of work.  Every time interrupts are enabled again, the
+/// simulated clock advances.
+static void
+Work(Ticks ticks)
+{
+    Ticks end = stats->totalTicks + ticks;
+    while (stats->totalTicks < end) {
+        interrupt->SetLevel(INT_OFF);
+        interrupt->SetLevel(INT_ON);
+    }
+}
+
+/// Hold the locks for a while.
+///
+/// * `dummy` is because every forked procedure takes one argument.
+static void
+Low(void *dummy)
+{
+    first->Acquire();
+    if (!chain)
+        second->Acquire();
+    ready->V();
+    go->P();
+
+    Work(HOLD_TICKS);
+    first->Release();
+    if (!chain) {
+        Work(HOLD_TICKS);
+        second->Release();
+    }
+}
+
+/// Wait for the lock of the low thread, holding the one of the high thread
+/// if in a chain.
+///
+/// * `dummy` is because every forked procedure takes one argument.
+static void
+Middle(void *dummy)
+{
+    if (chain)
+        second->Acquire();
+    ready->V();
+
+    first->Acquire();
+    first->Release();
+    if (chain)
+        second->Release();
+}
+
+/// Wait for `second`, and record for how long.
+///
+/// * `dummy` is because every forked procedure takes one argument.
+static void
+High(void *dummy)
+{
+    ready->V();
+
+    Ticks start = stats->totalTicks;
+    second->Acquire();
+    waited = stats->totalTicks - start;
+    second->Release();
+}
+
+/// Work without any lock.
+///
+/// * `dummy` is because every forked procedure takes one argument.
+static void
+Medium(void *dummy)
+{
+    Work(WORK_TICKS);
+}
+
+/// Run `count` rounds of a case, and report how long the high thread
+/// waited.
+static void
+RunCase(const char *what, unsigned count)
+{
+    Ticks worst = 0, total = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        first  = new Lock("first");
+        second = new Lock("second");
+        ready  = new Semaphore("ready", 0);
+        go     = new Semaphore("go", 0);
+
+        // Every thread is let to take its locks, and block waiting for the
+        // others, before the next one starts.
+        Thread *low    = new Thread("low", true, LOW_PRIORITY);
+        Thread *middle = new Thread("middle", true, MIDDLE_PRIORITY);
+        Thread *high   = new Thread("high", true, HIGH_PRIORITY);
+        Thread *medium = new Thread("medium", true, MEDIUM_PRIORITY);
+        low->Fork(Low, NULL);
+        ready->P();
+        middle->Fork(Middle, NULL);
+        ready->P();
+        high->Fork(High, NULL);
+        ready->P();
+        medium->Fork(Medium, NULL);
+        go->V();
+
+        low->Join();
+        middle->Join();
+        high->Join();
+        medium->Join();
+        delete low;
+        delete middle;
+        delete high;
+        delete medium;
+
+        delete first;
+        delete second;
+        delete ready;
+        delete go;
+
+        if (waited > worst)
+            worst = waited;
+        total += waited;
+    }
+
+    printf("%s: the high thread waited %llu ticks at worst, %llu on"
+           " average.\n", what, worst, count > 0 ? total / count : 0);
+}
+
+/// Run `count` rounds of every case, and report how long the high thread
+/// waited in each.
+void
+DonationLatencyTest(unsigned count)
+{
+    printf("Donation latency test: %u rounds of each case, holding locks"
+           " for %llu ticks against %llu ticks of other work.\n",
+           count, HOLD_TICKS, WORK_TICKS);
+
+    chain = true;
+    RunCase("Chain of locks", count);
+    chain = false;
+    RunCase("Several held locks", count);
+}
@@ -0,0 +1,229 @@
+/// Routines to schedule threads by their share of the CPU.
+///
+/// Virtual times are in fractions of a tick at weight 1, chosen by each
+/// policy (see `FAIR_VIRTUAL_TICK` and `STRIDE_VIRTUAL_TICK`).  They only
+/// ever grow, and may wrap around: as in the completely fair scheduler of
+/// Linux, two of them are compared by the sign of their difference, which
+/// is right as long as they are less than 2^63 units apart.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "fair_share_policy.hh"
+#include "system.hh"
+
+
+/// Initial number of entries of the heap of ready threads.
+static const unsigned INITIAL_CAPACITY = 16;
+
+FairSharePolicy::FairSharePolicy(unsigned long long tick)
+{
+    ASSERT(tick > 0);
+
+    virtualTick   = tick;
+    virtualNow    = 0;
+    readyCapacity = INITIAL_CAPACITY;
+    numReady      = 0;
+    ready         = new Thread *[readyCapacity];
+}
+
+FairSharePolicy::~FairSharePolicy()
+{
+    delete [] ready;
+}
+
+/// Insert `thread` in the heap, growing it if it is full.
+///
+/// A new thread starts at the virtual time of the system, whatever its own
+/// says, since that may be far behind or, after a wrap around, ahead.
+void
+FairSharePolicy::Enqueue(Thread *thread)
+{
+    ThreadStatus status = thread->GetStatus();
+    if (status == JUST_CREATED)
+        thread->virtualTime = virtualNow;
+    else if (status == BLOCKED)
+        Place(thread);
+
+    if (numReady == readyCapacity) {
+        Thread **bigger = new Thread *[2 * readyCapacity];
+        for (unsigned i = 0; i < numReady; i++)
+            bigger[i] = ready[i];
+        delete [] ready;
+        ready = bigger;
+        readyCapacity *= 2;
+    }
+
+    // Sift up from the new leaf.
+    unsigned i = numReady++;
+    while (i > 0 && Earlier(thread->virtualTime,
+                            ready[(i - 1) / 2]->virtualTime)) {
+        ready[i] = ready[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    ready[i] = thread;
+}
+
+/// Remove the root of the heap.
+Thread *
+FairSharePolicy::Dequeue()
+{
+    if (numReady == 0)
+        return NULL;
+
+    Thread *first = ready[0];
+
+    // Sift the last leaf down from the root.
+    Thread *last = ready[--numReady];
+    unsigned i = 0;
+    for (;;) {
+        unsigned child = 2 * i + 1;
+        if (child >= numReady)
+            break;
+        if (child + 1 < numReady
+              && Earlier(ready[child + 1]->virtualTime,
+                         ready[child]->virtualTime))
+            child++;
+        if (!Earlier(ready[child]->virtualTime, last->virtualTime))
+            break;
+        ready[i] = ready[child];
+        i = child;
+    }
+    ready[i] = last;
+
+    Advance(first);
+    return first;
+}
+
+/// Any ready thread may be owed the CPU by now.
+bool
+FairSharePolicy::WantsTimer(Thread *current) const
+{
+    return numReady > 0;
+}
+
+void
+FairSharePolicy::Charge(Thread *thread, Ticks ticks)
+{
+    thread->virtualTime += VirtualTicks(ticks,
+                                        Weight(thread->GetPriority()));
+    Advance(thread);
+}
+
+/// The virtual time of the thread stays the same, so it keeps its place;
+/// its new weight counts from the next ticks it is charged for.
+void
+FairSharePolicy::PriorityChanged(Thread *thread, int oldPriority)
+{}
+
+void
+FairSharePolicy::Print() const
+{
+    // The heap is not sorted; threads are printed in heap order, with
+    // their virtual time relative to that of the system.
+    for (unsigned i = 0; i < numReady; i++)
+        printf("%s (%lld), ", ready[i]->GetName(),
+               (long long) (ready[i]->virtualTime - virtualNow));
+    printf("\n");
+}
+
+/// Split the product, so that it does not overflow.
+unsigned long long
+FairSharePolicy::VirtualTicks(Ticks ticks, unsigned long long weight) const
+{
+    ASSERT(weight > 0);
+    return ticks / weight * virtualTick
+           + ticks % weight * virtualTick / weight;
+}
+
+bool
+FairSharePolicy::Earlier(unsigned long long a, unsigned long long b)
+{
+    return (long long) (a - b) < 0;
+}
+
+Thread *
+FairSharePolicy::Head() const
+{
+    return numReady > 0 ? ready[0] : NULL;
+}
+
+void
+FairSharePolicy::Advance(Thread *thread)
+{
+    unsigned long long earliest = thread->virtualTime;
+    if (numReady > 0 && Earlier(ready[0]->virtualTime, earliest))
+        earliest = ready[0]->virtualTime;
+    if (Earlier(virtualNow, earliest))
+        virtualNow = earliest;
+}
+
+/// Yield to a thread with an earlier pass.
+bool
+StridePolicy::Tick(Thread *current, Ticks sliceTicks)
+{
+    Thread *head = Head();
+    return head != NULL && Earlier(head->virtualTime, current->virtualTime);
+}
+
+/// Tickets of threads of `priority`.
+unsigned long long
+StridePolicy::Weight(int priority) const
+{
+    return priority + 1;
+}
+
+StridePolicy::StridePolicy()
+  : FairSharePolicy(STRIDE_VIRTUAL_TICK)
+{}
+
+/// A thread that waited must not get a share for the time it was not
+/// ready, or it would take the CPU for as long.
+void
+StridePolicy::Place(Thread *thread)
+{
+    if (Earlier(thread->virtualTime, virtualNow))
+        thread->virtualTime = virtualNow;
+}
+
+FairPolicy::FairPolicy()
+  : FairSharePolicy(FAIR_VIRTUAL_TICK)
+{
+    unsigned long long weight = 1024;
+    for (int i = 0; i < MAX_PRIORITY; i++) {
+        weights[i] = weight;
+        weight += weight / 4;
+    }
+}
+
+/// Yield once the earliest ready thread is far enough behind, so that
+/// threads of equal weight do not switch on every tick.
+bool
+FairPolicy::Tick(Thread *current, Ticks sliceTicks)
+{
+    Thread *head = Head();
+    return head != NULL
+           && Earlier(head->virtualTime + VirtualTicks(FAIR_GRANULARITY,
+                                                       weights[0]),
+                      current->virtualTime);
+}
+
+unsigned long long
+FairPolicy::Weight(int priority) const
+{
+    return weights[priority];
+}
+
+/// A thread that waited keeps its own virtual time, but no further behind
+/// than `FAIR_SLEEPER_CREDIT`: enough to run ahead of threads that compute,
+/// but not to hold the CPU for as long as it slept.
+void
+FairPolicy::Place(Thread *thread)
+{
+    unsigned long long earliest
+      = virtualNow - VirtualTicks(FAIR_SLEEPER_CREDIT, weights[0]);
+    if (Earlier(thread->virtualTime, earliest))
+        thread->virtualTime = earliest;
+}
@@ -0,0 +1,159 @@
+/// Data structures for scheduling threads by their share of the CPU.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_FAIRSHAREPOLICY__HH
+#define NACHOS_THREADS_FAIRSHAREPOLICY__HH
+
+
+#include "scheduling_policy.hh"
+
+
+/// Virtual time of a tick at weight 1 for stride scheduling: the `stride1`
+/// of Waldspurger's stride scheduler.  A thread of priority 0 has weight 1,
+/// so its pass takes 2^43 ticks to get 2^63 units ahead of another.
+#define STRIDE_VIRTUAL_TICK (1ULL << 20)
+
+/// Virtual time of a tick at weight 1 for the fair policy.  Its weights
+/// start at 1024, so a tick is 2^22 units at priority 0, and still a few
+/// units at the heaviest weight.
+#define FAIR_VIRTUAL_TICK (1ULL << 32)
+
+/// Ticks, at the weight of priority 0, that a thread may run ahead of the
+/// earliest ready thread before yielding to it.
+#define FAIR_GRANULARITY (TIMER_TICKS / 2)
+
+/// Ticks, at the weight of priority 0, of virtual time that a waking
+/// thread may be credited with.
+#define FAIR_SLEEPER_CREDIT (3 * TIMER_TICKS)
+
+
+/// The following class defines what fair-share policies have in common:
+/// every thread has a virtual time, that advances as it runs, more slowly
+/// the higher its weight, and the ready thread with the earliest virtual
+/// time runs next.  Over time, every thread that stays ready gets a share
+/// of the CPU proportional to its weight.
+///
+/// Subclasses decide the weight of a priority, where a thread that waited
+/// joins in virtual time, and when the running thread yields.
+class FairSharePolicy : public SchedulingPolicy {
+public:
+
+    /// Initialize the queue of ready threads, empty.
+    ///
+    /// * `tick` is the virtual time of a tick at weight 1.
+    FairSharePolicy(unsigned long long tick);
+
+    /// De-allocate the queue of ready threads.
+    virtual ~FairSharePolicy();
+
+    void Enqueue(Thread *thread);
+
+    Thread *Dequeue();
+
+    bool WantsTimer(Thread *current) const;
+
+    void Charge(Thread *thread, Ticks ticks);
+
+    void PriorityChanged(Thread *thread, int oldPriority);
+
+    void Print() const;
+
+protected:
+
+    /// Weight of threads of `priority`.
+    virtual unsigned long long Weight(int priority) const = 0;
+
+    /// Set the virtual time of `thread`, that waited (see `Enqueue`),
+    /// before it joins the ready threads again.
+    virtual void Place(Thread *thread) = 0;
+
+    /// Virtual time that running for `ticks` takes with `weight`.
+    unsigned long long VirtualTicks(Ticks ticks,
+                                    unsigned long long weight) const;
+
+    /// Is virtual time `a` earlier than `b`?  Correct even if one of them
+    /// wrapped around.
+    static bool Earlier(unsigned long long a, unsigned long long b);
+
+    /// The ready thread with the earliest virtual time; `NULL` if none.
+    Thread *Head() const;
+
+    /// Virtual time of the system: the earliest virtual time among the
+    /// running and the ready threads, but never decreasing.
+    unsigned long long virtualNow;
+
+private:
+
+    /// Virtual time of a tick at weight 1.
+    unsigned long long virtualTick;
+
+    /// The ready threads, as a binary min-heap ordered by virtual time:
+    /// the children of `ready[i]` are `ready[2 * i + 1]` and
+    /// `ready[2 * i + 2]`.
+    ///
+    /// The array only ever grows, so once it is big enough, a thread
+    /// becoming ready allocates nothing.
+    Thread **ready;
+    unsigned numReady;       ///< Entries of `ready` in use.
+    unsigned readyCapacity;  ///< Entries allocated for `ready`.
+
+    /// Make `virtualNow` catch up with `thread`, that is about to run or
+    /// running.
+    void Advance(Thread *thread);
+};
+
+/// The following class defines stride scheduling: a thread has one ticket
+/// per priority plus one, and its virtual time, or pass, advances by a
+/// stride inversely proportional to its tickets.
+///
+/// A thread that waited joins at the current pass of the system, without
+/// credit for the time it was not ready, and the running thread yields as
+/// soon as another has an earlier pass.
+class StridePolicy : public FairSharePolicy {
+public:
+
+    /// Initialize the queue of ready threads, empty.
+    StridePolicy();
+
+    bool Tick(Thread *current, Ticks sliceTicks);
+
+protected:
+
+    unsigned long long Weight(int priority) const;
+
+    void Place(Thread *thread);
+};
+
+/// The following class defines a scheduler in the style of the completely
+/// fair scheduler of Linux: the weight grows by a fourth with every
+/// priority, and a thread runs until it is `FAIR_GRANULARITY` ahead of the
+/// earliest ready thread in virtual time.
+///
+/// A thread that waited may join up to `FAIR_SLEEPER_CREDIT` ticks behind
+/// the virtual time of the system, so that threads that do I/O run soon
+/// after they wake up.
+class FairPolicy : public FairSharePolicy {
+public:
+
+    /// Compute the weight of every priority.
+    FairPolicy();
+
+    bool Tick(Thread *current, Ticks sliceTicks);
+
+protected:
+
+    unsigned long long Weight(int priority) const;
+
+    void Place(Thread *thread);
+
+private:
+
+    /// Weight of every priority.
+    unsigned long long weights[MAX_PRIORITY];
+};
+
+
+#endif
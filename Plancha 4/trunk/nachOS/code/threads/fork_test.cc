@@ -0,0 +1,50 @@
+/// Performance test for creating threads.
+///
+/// Forks threads that do nothing, one at a time, and joins and deletes
+/// each before forking the next, as a shell running one command after
+/// another does.  This measures the host cost of `Thread::Fork`,
+/// `Thread::Finish` and the context switches in between, most of which is
+/// getting a stack and giving it back (see `stackPool`, and `-sp` to
+/// change how many free stacks it keeps).
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "system.hh"
+
+#include <time.h>
+
+
+/// Body of every forked thread: return at once.
+///
+/// * `dummy` is because every forked procedure takes one argument.
+static void
+DoNothing(void *dummy)
+{}
+
+/// Fork and join `count` threads, and report how long it took.
+void
+ForkPerformanceTest(unsigned count)
+{
+    printf("Fork performance test: %u threads, forked and joined one at a"
+           " time.\n", count);
+
+    Ticks   startTicks = stats->totalTicks;
+    clock_t start = clock();
+
+    for (unsigned i = 0; i < count; i++) {
+        Thread *t = new Thread("fork test", true,
+                               currentThread->GetPriority());
+        t->Fork(DoNothing, NULL);
+        t->Join();
+        delete t;
+    }
+
+    double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("Forked and joined %u threads in %llu ticks and %.3f seconds"
+           " (%.2f microseconds per thread).\n",
+           count, stats->totalTicks - startTicks, seconds,
+           count > 0 ? seconds * 1e6 / count : 0.0);
+}
@@ -0,0 +1,85 @@
+/// Performance test for the interrupt simulator.
+///
+/// Keeps a fixed number of device interrupts pending, at pseudo-random
+/// times, and lets simulated time run until a given number of them have
+/// fired; every interrupt schedules a new one when it fires, as devices do.
+/// This stresses `Interrupt::Schedule` and the pending interrupt queue
+/// without anything else going on.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "system.hh"
+
+#include <time.h>
+
+
+/// Interrupts kept pending at any time.
+static const unsigned OUTSTANDING = 64;
+
+/// Interrupts still to be scheduled, and interrupts already fired.
+static unsigned toSchedule, fired;
+
+/// State of the pseudo-random delays, so that every run does the same.
+static unsigned delaySeed;
+
+/// Return a delay between 1 and 1000 ticks.
+static unsigned
+NextDelay()
+{
+    delaySeed = delaySeed * 1103515245 + 12345;
+    return 1 + (delaySeed >> 16) % 1000;
+}
+
+static void InterruptTestHandler(void *dummy);
+
+/// Schedule one more interrupt.
+static void
+ScheduleOne()
+{
+    toSchedule--;
+    interrupt->Schedule(InterruptTestHandler, NULL, NextDelay(), DISK_INT);
+}
+
+/// Count the interrupt and replace it with a new one, if any are left.
+///
+/// * `dummy` is because every interrupt handler takes one argument.
+static void
+InterruptTestHandler(void *dummy)
+{
+    fired++;
+    if (toSchedule > 0)
+        ScheduleOne();
+}
+
+/// Fire `count` interrupts, and report how long it took.
+void
+InterruptPerformanceTest(unsigned count)
+{
+    printf("Interrupt performance test: %u interrupts, %u pending at a"
+           " time.\n", count, OUTSTANDING);
+
+    toSchedule = count;
+    fired = 0;
+    delaySeed = 1;
+    for (unsigned i = 0; i < OUTSTANDING && toSchedule > 0; i++)
+        ScheduleOne();
+
+    Ticks   startTicks = stats->totalTicks;
+    clock_t start = clock();
+
+    // Every time interrupts are re-enabled, simulated time advances and
+    // any interrupt due is fired.
+    while (fired < count) {
+        interrupt->SetLevel(INT_OFF);
+        interrupt->SetLevel(INT_ON);
+    }
+
+    double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("Fired %u interrupts in %llu ticks and %.3f seconds"
+           " (%.0f interrupts per second).\n",
+           fired, stats->totalTicks - startTicks, seconds,
+           seconds > 0 ? fired / seconds : 0.0);
+}
@@ -10,8 +10,14 @@
 /// Usage
 /// =====
 ///
-///     nachos [-d <debugflags>] [-p] [-rs <random seed #>] [-z]
-///            [-s] [-x <nachos file>] [-tc <consoleIn> <consoleOut>]
+///     nachos [-d <debugflags>] [-p [<time slice>]] [-pt [<time slice>]]
+///            [-rs <random seed #>] [-dt] [-sched <policy>] [-sp <count>]
+///            [-z] [-ti <count>] [-tj <count>] [-ts <count>] [-td <count>]
+///            [-s] [-bb] [-jit [<threshold>]] [-prof [<period>]]
+///            [-js <json file>] [-mem <kilobytes>] [-ps <page size>]
+///            [-x <nachos file>] [-tp <nachos file>...]
+///            [-snap <snapshot file> <ticks>] [-resume <snapshot file>]
+///            [-tc <consoleIn> <consoleOut>]
 ///            [-f] [-cp <unix file> <nachos file>] [-pr <nachos file>]
 ///            [-rm <nachos file>] [-ls] [-D] [-tf]
 ///            [-n <network reliability>] [-id <machine id>]
@@ -22,16 +28,70 @@
 ///
 /// * `-d`  -- causes certain debugging messages to be printed (cf.
 ///   `utility.hh`).
-/// * `-p`  -- enables preemptive multitasking for kernel threads.
+/// * `-p`  -- enables preemptive multitasking for kernel threads, with a
+///   time slice of `time slice` microseconds of host CPU time (10000 by
+///   default); threads are switched on their next tick.
+/// * `-pt` -- like `-p`, but preempts at any host instruction, by tracing
+///   Nachos with `ptrace` (much slower); `time slice` is in host
+///   instructions (50000 by default).
 /// * `-rs` -- causes `Yield` to occur at random (but repeatable) spots.
+/// * `-dt` -- dynamic ticks: only runs the timer while another thread of
+///   the same or higher priority is ready to run, instead of interrupting
+///   every time slice regardless (ignored with `-snap`).
+/// * `-sched` -- chooses how ready threads are scheduled (see
+///   `scheduling_policy.hh`):
+///   * `priority` (the default) -- highest priority first, round robin
+///     within a priority;
+///   * `mlfq` -- like `priority`, but threads of priority below 8, such as
+///     user programs, are in a multilevel feedback queue: a thread that
+///     uses up its time slice drops a level, one that waits for the console
+///     or the disk rises one, and threads left waiting are raised
+///     periodically; prints the ticks run at each priority at halt;
+///   * `stride` -- stride scheduling, with a share of the CPU proportional
+///     to the priority plus one;
+///   * `fair` -- in the style of the Linux completely fair scheduler, with
+///     a share that grows by a fourth with every priority.
+/// * `-sp` -- keeps up to `count` stacks of finished threads for new ones
+///   (16 by default; 0 frees every stack at once).
 /// * `-z`  -- prints version and copyright information, and exits.
+/// * `-ti` -- tests the performance of the interrupt simulator, by firing
+///   `count` device interrupts.
+/// * `-tj` -- tests the performance of creating threads, by forking and
+///   joining `count` of them, one at a time.
+/// * `-ts` -- tests the performance of context switches, by bouncing
+///   between two threads on semaphores `count` times, then having several
+///   threads yield `count` times in all.
+/// * `-td` -- tests the latency of priority donation, by timing `count`
+///   times how long a thread of high priority waits for a lock held by one
+///   of low priority, through a chain of locks and through a second lock;
+///   best run with `-dt`.
 ///
 /// *USER_PROGRAM* options
 /// ----------------------
 ///
 /// * `-s`  -- causes user programs to be executed in single-step mode.
+/// * `-bb` -- runs user programs with the threaded-code (basic block)
+///   interpreter instead of decoding one instruction at a time.
+/// * `-jit` -- like `-bb`, and also translates blocks to host code once
+///   they have run `threshold` times (32 by default).
+/// * `-prof` -- samples the program counter of user programs every `period`
+///   ticks (100 by default); at halt, prints a flat profile per program and
+///   writes folded stacks to `nachos.folded`.
+/// * `-js` -- at halt, also writes the statistics, with the instruction mix
+///   of user programs, as JSON to `json file`.
+/// * `-mem` -- sets the size of main memory (16 KB by default), which must
+///   be a whole number of pages.
+/// * `-ps` -- sets the size of a page in bytes (128 by default): a power of
+///   two, and a multiple of the disk sector size.
 /// * `-x`  -- runs a user program.
+/// * `-snap` -- saves the state of the machine to `snapshot file`, at the
+///   first timer interrupt after `ticks` when only one user program is
+///   running (see `userprog/snapshot.hh`).
+/// * `-resume` -- instead of running a program, starts from a snapshot.
 /// * `-tc` -- tests the console.
+/// * `-tp` -- tests the scheduling policy, by running the programs named up
+///   to the next flag at once, and printing the share of the CPU and the
+///   turnaround of each.
 ///
 /// *FILESYS* options
 /// -----------------
@@ -71,10 +131,16 @@
 // External functions used by this file.
 
 void ThreadTest();
+void InterruptPerformanceTest(unsigned count);
+void ForkPerformanceTest(unsigned count);
+void SwitchPerformanceTest(unsigned count);
+void DonationLatencyTest(unsigned count);
 void Copy(const char *unixFile, const char *nachosFile);
 void Print(const char *file);
 void PerformanceTest(void);
 void StartProcess(const char *file);
+void SchedulingPerformanceTest(char **programs, unsigned count);
+void ResumeSnapshot(const char *file);
 void ConsoleTest(const char *in, const char *out);
 void MailTest(int networkID);
 
@@ -110,12 +176,37 @@ main(int argc, char **argv)
         if (!strcmp(*argv, "-z")) {          // Print version info and exit.
             PrintVersion();
             return 0;
+        } else if (!strcmp(*argv, "-ti")) {  // Interrupt performance test.
+            ASSERT(argc > 1);
+            InterruptPerformanceTest(atoi(*(argv + 1)));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-tj")) {  // Fork performance test.
+            ASSERT(argc > 1);
+            ForkPerformanceTest(atoi(*(argv + 1)));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-ts")) {  // Switch performance test.
+            ASSERT(argc > 1);
+            SwitchPerformanceTest(atoi(*(argv + 1)));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-td")) {  // Donation latency test.
+            ASSERT(argc > 1);
+            DonationLatencyTest(atoi(*(argv + 1)));
+            argCount = 2;
         }
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-x")) {          // Run a user program.
             ASSERT(argc > 1);
             StartProcess(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-tp")) {  // Scheduling performance test.
+            ASSERT(argc > 1);
+            while (argCount < argc && **(argv + argCount) != '-')
+                argCount++;
+            SchedulingPerformanceTest(argv + 1, argCount - 1);
+        } else if (!strcmp(*argv, "-resume")) {  // Start from a snapshot.
+            ASSERT(argc > 1);
+            ResumeSnapshot(*(argv + 1));
+            argCount = 2;
         } else if (!strcmp(*argv, "-tc")) {  // Test the console.
             if (argc == 1)
                 ConsoleTest(NULL, NULL);
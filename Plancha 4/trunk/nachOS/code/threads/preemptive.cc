@@ -12,8 +12,10 @@
 #include "system.hh"
 
 // UNIX and Linux-specific headers.
+#include <signal.h>
 #include <unistd.h>
 #include <sys/ptrace.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 #include <sys/user.h>
 
@@ -22,7 +24,65 @@ static void ContextSwitch();
 static void MonitorProcess(int childPid, unsigned long timeSliceLength);
 static void LetMeBeMonitored();
 
-static bool inContextSwitch = false;
+/// Set while a forced context switch is being decided, so that no other
+/// one is forced meanwhile.
+static volatile bool inContextSwitch = false;
+
+/// Whether `SetUpSignals` has armed the interval timer.
+static bool usingSignals = false;
+
+/// Called by the host at the end of every time slice.
+///
+/// Only a flag can be set safely here: the switch itself is made by
+/// `Interrupt::AdvanceTicks` at the next tick, that is, at the next user
+/// instruction or when interrupts are enabled again.
+static void
+SliceExpired(int signal)
+{
+    if (inContextSwitch)
+        return;
+    inContextSwitch = true;
+    interrupt->YieldOnReturn();
+    inContextSwitch = false;
+}
+
+PreemptiveScheduler::~PreemptiveScheduler()
+{
+    if (!usingSignals)
+        return;
+
+    struct itimerval stop;
+    memset(&stop, 0, sizeof stop);
+    setitimer(ITIMER_VIRTUAL, &stop, NULL);
+    usingSignals = false;
+}
+
+/// `ITIMER_VIRTUAL` only counts while Nachos is running, so a slice is not
+/// used up while the host process waits for input.
+void
+PreemptiveScheduler::SetUpSignals(unsigned long microseconds)
+{
+    ASSERT(microseconds > 0);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof action);
+    action.sa_handler = SliceExpired;
+    action.sa_flags   = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    int result = sigaction(SIGVTALRM, &action, NULL);
+    ASSERT(result == 0);
+
+    struct itimerval slice;
+    slice.it_interval.tv_sec  = microseconds / 1000000;
+    slice.it_interval.tv_usec = microseconds % 1000000;
+    slice.it_value            = slice.it_interval;
+    result = setitimer(ITIMER_VIRTUAL, &slice, NULL);
+    ASSERT(result == 0);
+    usingSignals = true;
+
+    DEBUG('p', "Preemptive scheduler: time slices of %lu us\n",
+          microseconds);
+}
 
 /// Set up the preemptive scheduler.
 ///
@@ -1,6 +1,12 @@
 /// Extension to make kernel threads be periodically preempted.
 ///
-/// It only works on Linux x86 environments.
+/// There are two ways to do it.  `SetUpSignals` has the host deliver a
+/// signal every time slice of CPU time, and the signal handler asks for a
+/// context switch at the next point where Nachos can take one safely (see
+/// `Interrupt::YieldOnReturn`).  `SetUp` forks a monitor process that
+/// single-steps Nachos with `ptrace`, and forces a context switch at any
+/// host instruction; it is much slower, and only works on Linux x86
+/// environments.
 ///
 /// Copyright (c) 2007      Universidad de Las Palmas de Gran Canaria.
 ///               2016-2017 Docentes de la Universidad Nacional de Rosario.
@@ -19,10 +25,19 @@ public:
     PreemptiveScheduler()
     {}
 
-    ~PreemptiveScheduler()
-    {}
+    /// Stop the time slice signals, if they were set up.
+    ~PreemptiveScheduler();
+
+    /// Set up time slicing between kernel threads, with signals.
+    ///
+    /// Threads are only switched when they advance simulated time: on every
+    /// user instruction, and whenever interrupts are enabled.
+    ///
+    /// * `microseconds` is the time slice duration, measured in CPU time
+    ///   of the host process.
+    void SetUpSignals(unsigned long microseconds);
 
-    /// Set up time slicing between kernel threads.
+    /// Set up time slicing between kernel threads, with `ptrace`.
     ///
     /// * `timeSliceLength` is the time slice duration, measured in native
     ///   x86 machine instructions.
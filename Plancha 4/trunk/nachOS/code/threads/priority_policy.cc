@@ -0,0 +1,236 @@
+/// Routines to schedule threads by priority.
+///
+/// There is a FIFO ready list per priority, and the highest priority with
+/// a ready thread runs first.  Which lists are not empty is kept as a bit
+/// mask, so that every operation takes constant time, however many
+/// priorities and threads there are.
+///
+/// Optionally, the lowest `MLFQ_LEVELS` priorities make up a multilevel
+/// feedback queue.  A thread forked with one of them starts at the top
+/// level instead.  Every time slice it runs out drops it one level, so that
+/// threads that compute for long end up at the bottom; every time it waits
+/// for the console or the disk raises it one, so that interactive threads
+/// stay at the top.  Every `MLFQ_AGING_TICKS`, the threads still waiting on
+/// the ready lists move up one level, so that none of them starves.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "priority_policy.hh"
+#include "system.hh"
+
+
+/// Return the highest level whose bit is set in `levels`, which must not be
+/// 0.
+static inline int
+HighestLevel(unsigned long long levels)
+{
+    return 63 - __builtin_clzll(levels);
+}
+
+PriorityPolicy::PriorityPolicy(bool mlfq)
+{
+    ASSERT(MAX_PRIORITY <= 8 * sizeof readyLevels);
+    ASSERT(MLFQ_LEVELS <= MAX_PRIORITY);
+
+    feedback    = mlfq;
+    readyLevels = 0;
+
+    lastAging = stats->totalTicks;
+    for (int i = 0; i < MAX_PRIORITY; i++)
+        levelTicks[i] = 0;
+    numDemotions = numBoosts = numAged = 0;
+}
+
+/// Put `thread` at the end of the ready list of its priority.
+void
+PriorityPolicy::Enqueue(Thread *thread)
+{
+    if (feedback && thread->GetStatus() == JUST_CREATED
+          && thread->GetRealPriority() < MLFQ_LEVELS)
+        thread->SetBasePriority(MLFQ_LEVELS - 1);
+
+    int priority = thread->GetPriority();
+    readyList[priority].Append(thread);
+    readyLevels |= 1ULL << priority;
+}
+
+/// Take the first thread of the highest priority with a ready thread.
+Thread *
+PriorityPolicy::Dequeue()
+{
+    if (readyLevels == 0)
+        return NULL;
+
+    int     priority = HighestLevel(readyLevels);
+    Thread *thread   = readyList[priority].Pop();
+    if (readyList[priority].IsEmpty())
+        readyLevels &= ~(1ULL << priority);
+    return thread;
+}
+
+/// A thread of lower priority is not meant to take the CPU from the current
+/// one, so the timer is only needed while a thread of the same or higher
+/// priority is ready -- or, with the feedback queue, while any thread is
+/// ready, since waiting threads are aged on timer interrupts.
+bool
+PriorityPolicy::WantsTimer(Thread *current) const
+{
+    if (feedback)
+        return readyLevels != 0;
+    return readyLevels >> current->GetPriority() != 0;
+}
+
+/// Without the feedback queue, the current thread always yields.  With it,
+/// the thread drops a level if it ran the whole slice, and it only yields
+/// to threads of its new priority or higher: the others are left to aging.
+bool
+PriorityPolicy::Tick(Thread *current, Ticks sliceTicks)
+{
+    if (!feedback)
+        return true;
+
+    int priority = current->GetRealPriority();
+    if (priority > 0 && priority < MLFQ_LEVELS && sliceTicks >= TIMER_TICKS) {
+        DEBUG('t', "Demoting thread \"%s\" to level %d\n",
+              current->GetName(), priority - 1);
+        SetLevel(current, priority - 1);
+        numDemotions++;
+    }
+
+    if (stats->totalTicks - lastAging >= MLFQ_AGING_TICKS) {
+        Age();
+        lastAging = stats->totalTicks;
+    }
+
+    return readyLevels >> current->GetPriority() != 0;
+}
+
+void
+PriorityPolicy::Charge(Thread *thread, Ticks ticks)
+{
+    levelTicks[thread->GetPriority()] += ticks;
+}
+
+/// Move `thread` to the ready list of its new priority, if it is ready.
+///
+/// Only a ready thread is moved: a thread that is waiting stays in the
+/// queue it waits in, and will be put on the ready list of its new
+/// priority once woken up.
+void
+PriorityPolicy::PriorityChanged(Thread *thread, int oldPriority)
+{
+    if (thread->GetStatus() != READY || thread->GetPriority() == oldPriority)
+        return;
+
+    RemoveReady(thread, oldPriority);
+    Enqueue(thread);
+}
+
+/// With the feedback queue, promote the thread, so that threads that do
+/// I/O are not kept waiting behind those that compute.
+void
+PriorityPolicy::WaitingForIO(Thread *thread)
+{
+    if (!feedback)
+        return;
+
+    int priority = thread->GetRealPriority();
+    if (priority < MLFQ_LEVELS - 1) {
+        DEBUG('t', "Boosting thread \"%s\" to level %d\n",
+              thread->GetName(), priority + 1);
+        SetLevel(thread, priority + 1);
+        numBoosts++;
+    }
+}
+
+/// Print the contents of the ready lists, for debugging.
+static void
+ThreadPrint(Thread *t)
+{
+    ASSERT(t != NULL);
+    t->Print();
+}
+
+void
+PriorityPolicy::Print() const
+{
+    for (int i = 0; i < MAX_PRIORITY; i++){
+        if (readyList[i].IsEmpty())
+            continue;
+        printf("Current priority: %d -- ", i);
+        readyList[i].Apply(ThreadPrint);
+        printf("\n");
+    }
+}
+
+/// With the feedback queue, print how long threads ran at every priority,
+/// and how often they changed levels.
+void
+PriorityPolicy::PrintStatistics() const
+{
+    if (!feedback)
+        return;
+
+    Ticks busy = 0;
+    for (int i = 0; i < MAX_PRIORITY; i++)
+        busy += levelTicks[i];
+
+    printf("Feedback queue: demotions %u, boosts %u, aged %u\n",
+           numDemotions, numBoosts, numAged);
+    for (int i = MAX_PRIORITY - 1; i >= 0; i--)
+        if (levelTicks[i] != 0)
+            printf("Priority %d: ticks %llu (%.1f%%)\n", i, levelTicks[i],
+                   100.0 * levelTicks[i] / busy);
+}
+
+void
+PriorityPolicy::RemoveReady(Thread *thread, int priority)
+{
+    readyList[priority].Remove(thread);
+    if (readyList[priority].IsEmpty())
+        readyLevels &= ~(1ULL << priority);
+}
+
+/// Move the thread in constant time, whether it is running or ready.  A
+/// running thread must have been charged for the ticks it ran at its old
+/// level.
+void
+PriorityPolicy::SetLevel(Thread *thread, int level)
+{
+    ASSERT(thread != NULL);
+    ASSERT(0 <= level && level < MLFQ_LEVELS);
+
+    int oldPriority = thread->GetPriority();
+    thread->SetBasePriority(level);
+    PriorityChanged(thread, oldPriority);
+}
+
+/// The levels are aged from the top down, so that no thread is raised more
+/// than once.  A thread keeps its place in the queue of its new level,
+/// after the ones already there.
+void
+PriorityPolicy::Age()
+{
+    for (int i = MLFQ_LEVELS - 2; i >= 0; i--) {
+        if (readyList[i].IsEmpty())
+            continue;
+
+        // A thread that was lent a higher priority may stay on this level,
+        // so the level is emptied before any thread is put back.
+        ThreadList aging;
+        Thread *thread;
+        while ((thread = readyList[i].Pop()) != NULL)
+            aging.Append(thread);
+        readyLevels &= ~(1ULL << i);
+
+        while ((thread = aging.Pop()) != NULL) {
+            thread->SetBasePriority(thread->GetRealPriority() + 1);
+            Enqueue(thread);
+            numAged++;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/// Data structures for scheduling threads by priority.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_PRIORITYPOLICY__HH
+#define NACHOS_THREADS_PRIORITYPOLICY__HH
+
+
+#include "scheduling_policy.hh"
+
+
+/// Priorities managed by the multilevel feedback queue, from 0 to
+/// `MLFQ_LEVELS - 1`; threads created with a higher priority keep it.
+#define MLFQ_LEVELS 8
+
+/// Ticks between two agings of the threads waiting on the ready lists of the
+/// multilevel feedback queue.
+#define MLFQ_AGING_TICKS (10 * TIMER_TICKS)
+
+
+/// The following class defines the priority scheduling policy: the highest
+/// priority with a ready thread runs first, and threads of the same
+/// priority take turns.
+class PriorityPolicy : public SchedulingPolicy {
+public:
+
+    /// Initialize the ready lists, empty.
+    ///
+    /// If `feedback` is set, the priorities below `MLFQ_LEVELS` are the
+    /// levels of a multilevel feedback queue: a thread in them moves down
+    /// when it uses up a time slice, and up when it waits for I/O or for
+    /// too long on the ready list.
+    PriorityPolicy(bool feedback);
+
+    void Enqueue(Thread *thread);
+
+    Thread *Dequeue();
+
+    bool WantsTimer(Thread *current) const;
+
+    bool Tick(Thread *current, Ticks sliceTicks);
+
+    void Charge(Thread *thread, Ticks ticks);
+
+    void PriorityChanged(Thread *thread, int oldPriority);
+
+    void WaitingForIO(Thread *thread);
+
+    void Print() const;
+
+    void PrintStatistics() const;
+
+private:
+
+    bool feedback;  ///< Schedule with a multilevel feedback queue.
+
+    /// Queue of threads that are ready to run, but not running, for every
+    /// priority.
+    ThreadList readyList[MAX_PRIORITY];
+
+    /// Bit `i` is set if `readyList[i]` is not empty, so that the highest
+    /// priority with a ready thread is found without looking at every list.
+    unsigned long long readyLevels;
+
+    /// Take the ready `thread` off the ready list of `priority`.
+    void RemoveReady(Thread *thread, int priority);
+
+    /// Move `thread`, which must not be waiting, to `level` of the feedback
+    /// queue.
+    void SetLevel(Thread *thread, int level);
+
+    /// Raise every thread on the ready lists of the feedback queue one
+    /// level.
+    void Age();
+
+    /// Ticks when the ready threads were last aged.
+    Ticks lastAging;
+
+    /// Busy ticks run at each priority, and level changes of each kind.
+    Ticks levelTicks[MAX_PRIORITY];
+    unsigned numDemotions;
+    unsigned numBoosts;
+    unsigned numAged;
+};
+
+
+#endif
@@ -9,8 +9,10 @@
 /// needed to wait for a lock, and the lock was busy, we would end up calling
 /// `FindNextToRun`, and that would put us in an infinite loop.
 ///
-/// Very simple implementation -- no priorities, straight FIFO.  Might need
-/// to be improved in later assignments.
+/// Which ready thread runs next is up to the scheduling policy (see
+/// `scheduling_policy.hh`).  The scheduler tells it how many busy ticks
+/// each thread runs: when it is switched out, and on every timer
+/// interrupt.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2018 Docentes de la Universidad Nacional de Rosario.
@@ -22,18 +24,27 @@
 #include "system.hh"
 
 
+/// Busy ticks so far.
+static inline Ticks
+BusyTicks()
+{
+    return stats->totalTicks - stats->idleTicks;
+}
+
 /// Initialize the list of ready but not running threads to empty.
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedulingPolicy *readyPolicy, bool dynamic)
 {
-    for (int i = 0; i < MAX_PRIORITY; i++)
-        readyList[i] = new List<Thread *>;
+    ASSERT(readyPolicy != NULL);
+
+    policy       = readyPolicy;
+    dynamicTicks = dynamic;
+    sliceStart   = lastAccount = BusyTicks();
 }
 
 /// De-allocate the list of ready threads.
 Scheduler::~Scheduler()
 {
-    for (int i = 0; i < MAX_PRIORITY; i++)
-        delete readyList[i];
+    delete policy;
 }
 
 /// Mark a thread as ready, but not running.
@@ -45,11 +56,14 @@ Scheduler::ReadyToRun(Thread *thread)
 {
     ASSERT(thread != NULL);
 
+    int priority = thread->GetPriority();
+    ASSERT(0 <= priority && priority < MAX_PRIORITY);
+
     DEBUG('t', "Putting thread %s on ready list\n", thread->GetName());
 
+    policy->Enqueue(thread);  // Before the status changes: see `Enqueue`.
     thread->SetStatus(READY);
-    
-    readyList[thread -> GetPriority()] -> Append(thread);
+    UpdateTimer();
 
 /* El siguiente codigo se encontraba en la version original del nachos
  *  readyList->Append(thread);
@@ -64,13 +78,7 @@ Scheduler::ReadyToRun(Thread *thread)
 Thread *
 Scheduler::FindNextToRun()
 {
-    for (int i = MAX_PRIORITY - 1; i >= 0; i--)
-    {
-        if (!(readyList[i] -> IsEmpty()))
-            return readyList[i]->Pop();
-    }
-
-    return NULL;
+    return policy->Dequeue();
 
 /* El siguiente codigo se encontraba en la version original del nachos
  *      return readyList->Pop();
@@ -106,8 +114,12 @@ Scheduler::Run(Thread *nextThread)
     oldThread->CheckOverflow();  // Check if the old thread had an undetected
                                  // stack overflow.
 
+    Account();
+    sliceStart = lastAccount;
+
     currentThread = nextThread;  // Switch to the next thread.
     currentThread->SetStatus(RUNNING);  // `nextThread` is now running.
+    UpdateTimer();
 
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
           oldThread->GetName(), nextThread->GetName());
@@ -143,35 +155,93 @@ Scheduler::Run(Thread *nextThread)
 /// list.
 ///
 /// For debugging.
-static void
-ThreadPrint(Thread *t)
+void
+Scheduler::Print()
 {
-    ASSERT(t != NULL);
-    t->Print();
+    printf("Ready list contents:\n");
+    policy->Print();
 }
 
+/// A timer interrupt makes the current thread yield to the first thread in
+/// the ready list; it is wasted if there is none, or if the policy would
+/// not take the CPU from the current thread for any of them.  So with
+/// dynamic ticks, the timer only runs while the policy wants it.
 void
-Scheduler::Print()
+Scheduler::UpdateTimer()
 {
-    printf("Ready list contents:\n");
-    for (int i = 0; i < MAX_PRIORITY; i++){
-        printf("Current priority: %d -- ", i);
-        readyList[i]->Apply(ThreadPrint);
-        printf("\n");
-    }
+    if (!dynamicTicks || currentThread == NULL)
+        return;
+
+    if (policy->WantsTimer(currentThread))
+        timer->Start();
+    else
+        timer->Stop();
 }
 
+/// Lend `thread` the higher `priority` of a thread waiting for its lock.
+///
+/// The policy is told about the change; a running thread is first charged
+/// for the ticks it ran at its old priority.
 void
-Scheduler::SchChangePriority(Thread *thread)
+Scheduler::SchChangePriority(Thread *thread, int priority)
 {
-    readyList[thread -> GetRealPriority()] -> FindAndRemove(thread);
-    ReadyToRun(thread);
+    ASSERT(thread != NULL);
+
+    if (thread == currentThread)
+        Account();
+
+    int oldPriority = thread -> GetPriority();
+    thread -> ChangePriority(priority);
+    policy -> PriorityChanged(thread, oldPriority);
 }
 
+/// Give `thread` back its own priority.
 void
 Scheduler::SchRestorePriority(Thread *thread)
 {
-    readyList[thread -> GetPriority()] -> FindAndRemove(thread);
+    ASSERT(thread != NULL);
+
+    if (thread == currentThread)
+        Account();
+
+    int oldPriority = thread -> GetPriority();
     thread -> RestorePriority();
-    ReadyToRun(thread);
+    policy -> PriorityChanged(thread, oldPriority);
+}
+
+bool
+Scheduler::SliceExpired()
+{
+    Account();
+    bool yield = policy->Tick(currentThread, lastAccount - sliceStart);
+    sliceStart = lastAccount;
+    return yield;
+}
+
+/// Called by `SynchConsole` and `SynchDisk` before waiting for a request to
+/// complete.
+///
+/// Only the current thread is changed, so interrupts need not be disabled.
+void
+Scheduler::WaitingForIO()
+{
+    Account();
+    policy->WaitingForIO(currentThread);
+}
+
+void
+Scheduler::PrintStatistics()
+{
+    Account();
+    policy->PrintStatistics();
+}
+
+void
+Scheduler::Account()
+{
+    Ticks now   = BusyTicks();
+    Ticks ticks = now - lastAccount;
+    currentThread->runTicks += ticks;
+    policy->Charge(currentThread, ticks);
+    lastAccount = now;
 }
@@ -10,10 +10,8 @@
 #ifndef NACHOS_THREADS_SCHEDULER__HH
 #define NACHOS_THREADS_SCHEDULER__HH
 
-#define MAX_PRIORITY 10
 
-#include "thread.hh"
-#include "lib/list.hh"
+#include "scheduling_policy.hh"
 
 
 /// The following class defines the scheduler/dispatcher abstraction --
@@ -22,8 +20,12 @@
 class Scheduler {
 public:
 
-    /// Initialize list of ready threads.
-    Scheduler();
+    /// Initialize list of ready threads, kept by `policy`, which the
+    /// scheduler then owns.
+    ///
+    /// If `dynamicTicks` is set, the timer is only kept running while there
+    /// is some thread to time-slice with (see `UpdateTimer`).
+    Scheduler(SchedulingPolicy *policy, bool dynamicTicks = false);
 
     /// De-allocate ready list.
     ~Scheduler();
@@ -41,13 +43,40 @@ public:
     void Print();
 
     // Reubican threads para la inversion de prioridades
-    void SchChangePriority(Thread *thread);
+    void SchChangePriority(Thread *thread, int priority);
     void SchRestorePriority(Thread *thread);
 
+    /// With dynamic ticks, start the timer if the policy has some ready
+    /// thread to time-slice with, and stop it otherwise.
+    ///
+    /// Called whenever a thread becomes ready or is dispatched.
+    void UpdateTimer();
+
+    /// Called on every timer interrupt that finds a thread running; return
+    /// whether it should yield.
+    bool SliceExpired();
+
+    /// Tell the policy that the current thread is about to wait for a
+    /// device.
+    void WaitingForIO();
+
+    /// Print the statistics of the policy.
+    void PrintStatistics();
+
 private:
 
-    // Queue of threads that are ready to run, but not running.
-    List<Thread*> *readyList[MAX_PRIORITY];
+    SchedulingPolicy *policy;  ///< Keeps the ready threads.
+
+    bool dynamicTicks;  ///< Stop the timer when there is nothing to
+                        ///< time-slice between.
+
+    /// Charge the ticks run since the last call to the current thread.
+    void Account();
+
+    /// Busy ticks (not idle ones) when the time slice of the current thread
+    /// began, and when it was last charged for.
+    Ticks sliceStart;
+    Ticks lastAccount;
 
 };
 
@@ -0,0 +1,80 @@
+/// Interface between the scheduler and the policies it can choose threads
+/// with.
+///
+/// `Scheduler` does the dispatching: it switches between threads, keeps the
+/// timer running only while needed, and measures how long each thread runs.
+/// Which ready thread runs next, and for how long, is up to a
+/// `SchedulingPolicy`, chosen at startup with `-sched` (see `main.cc`):
+///
+/// * `PriorityPolicy` runs the highest priority first, round robin within
+///   a priority, optionally as a multilevel feedback queue.
+/// * `StridePolicy` gives every thread a share of the CPU proportional to
+///   its priority plus one, as stride scheduling does with tickets.
+/// * `FairPolicy` runs the thread that has run least, weighted by its
+///   priority, as the completely fair scheduler of Linux does.
+///
+/// Like the scheduler, policies assume interrupts are disabled.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_SCHEDULINGPOLICY__HH
+#define NACHOS_THREADS_SCHEDULINGPOLICY__HH
+
+/// Number of priority levels, from 0 (the lowest) to `MAX_PRIORITY - 1`.
+///
+/// At most 64, the bits in `PriorityPolicy::readyLevels`.
+#define MAX_PRIORITY 64
+
+#include "thread.hh"
+#include "machine/statistics.hh"
+
+
+/// The following class defines the operations of a scheduling policy, that
+/// keeps the threads that are ready to run.
+class SchedulingPolicy {
+public:
+
+    virtual ~SchedulingPolicy() {}
+
+    /// Keep `thread`, which is ready to run.
+    ///
+    /// Called before the status of the thread becomes `READY`, so that the
+    /// policy can tell a new thread (`JUST_CREATED`) or one that waited
+    /// (`BLOCKED`) from one that gave up the CPU (`RUNNING`).
+    virtual void Enqueue(Thread *thread) = 0;
+
+    /// Take the thread to run next off the ready threads, and return it;
+    /// `NULL` if there is none.
+    virtual Thread *Dequeue() = 0;
+
+    /// Is there some ready thread the timer should make `current` yield to?
+    /// Used with dynamic ticks to stop the timer when there is not.
+    virtual bool WantsTimer(Thread *current) const = 0;
+
+    /// Called on every timer interrupt that finds `current` running, after
+    /// `sliceTicks` busy ticks since it was dispatched or last ticked.
+    /// Return whether it should yield.
+    virtual bool Tick(Thread *current, Ticks sliceTicks) = 0;
+
+    /// `thread`, running, ran `ticks` busy ticks at its present priority.
+    virtual void Charge(Thread *thread, Ticks ticks) = 0;
+
+    /// The priority of `thread`, which may be ready, running or waiting,
+    /// has just changed from `oldPriority`.
+    virtual void PriorityChanged(Thread *thread, int oldPriority) = 0;
+
+    /// `thread`, running, is about to wait for a device.
+    virtual void WaitingForIO(Thread *thread) {}
+
+    /// Print the ready threads, for debugging.
+    virtual void Print() const = 0;
+
+    /// Print statistics of the policy, at halt.
+    virtual void PrintStatistics() const {}
+
+};
+
+
+#endif
@@ -0,0 +1,50 @@
+/// Routines to recycle the execution stacks of threads.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "stack_pool.hh"
+#include "system.hh"
+
+
+/// Bytes in a stack.
+static const unsigned STACK_BYTES = STACK_SIZE * sizeof (HostMemoryAddress);
+
+StackPool::StackPool(unsigned maxFree)
+{
+    capacity = maxFree;
+    count    = 0;
+    stacks   = capacity > 0 ? new HostMemoryAddress *[capacity] : NULL;
+}
+
+StackPool::~StackPool()
+{
+    for (unsigned i = 0; i < count; i++)
+        DeallocBoundedArray((char *) stacks[i], STACK_BYTES);
+    delete [] stacks;
+}
+
+HostMemoryAddress *
+StackPool::Get()
+{
+    if (count > 0) {
+        DEBUG('t', "Reusing stack %p\n", stacks[count - 1]);
+        return stacks[--count];
+    }
+    return (HostMemoryAddress *) AllocBoundedArray(STACK_BYTES);
+}
+
+/// The caller must have checked `stack` for overflows: a stack whose
+/// bottom was overwritten must not be handed out again.
+void
+StackPool::Put(HostMemoryAddress *stack)
+{
+    ASSERT(stack != NULL);
+
+    if (count < capacity)
+        stacks[count++] = stack;
+    else
+        DeallocBoundedArray((char *) stack, STACK_BYTES);
+}
@@ -0,0 +1,48 @@
+/// Data structures for recycling the execution stacks of threads.
+///
+/// Every stack is mapped with an inaccessible guard page at each end, so
+/// that running off it faults instead of overwriting something else; that
+/// takes several system calls to set up and one more to tear down.  So
+/// instead of giving back the stack of a thread that is done, it is kept
+/// for the next `Thread::Fork`, up to a configurable number of them.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_STACKPOOL__HH
+#define NACHOS_THREADS_STACKPOOL__HH
+
+
+#include "thread.hh"
+
+
+/// The following class defines a pool of free thread stacks, each of
+/// `STACK_SIZE` words.
+class StackPool {
+public:
+
+    /// Keep up to `maxFree` free stacks; with 0, every stack is given back
+    /// to the host as soon as it is freed.
+    StackPool(unsigned maxFree);
+
+    /// Give back every free stack.
+    ~StackPool();
+
+    /// Return the bottom of a stack: a free one if there is any, else a new
+    /// one.
+    HostMemoryAddress *Get();
+
+    /// Keep `stack` for a later `Get`, or give it back if the pool is full.
+    void Put(HostMemoryAddress *stack);
+
+private:
+
+    /// The free stacks, `count` of them.
+    HostMemoryAddress **stacks;
+    unsigned count;
+    unsigned capacity;
+};
+
+
+#endif
@@ -0,0 +1,109 @@
+/// Performance tests for context switches between kernel threads.
+///
+/// Two workloads that do nothing but switch threads, so that their cost is
+/// that of the scheduler and the synchronization primitives: the ready
+/// lists, the queues of semaphores, and `SWITCH` itself.
+///
+/// * A semaphore ping-pong: two threads take turns, each waking the other
+///   with `V` and then waiting for it with `P`.
+/// * A yield storm: several threads of the same priority call `Yield` in a
+///   loop, so that each call moves the caller to the end of the ready list.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "synch.hh"
+#include "system.hh"
+
+#include <time.h>
+
+
+/// Threads taking part in the yield storm.
+static const unsigned YIELDERS = 8;
+
+/// Round trips, or yields per thread, still to go.
+static unsigned rounds;
+
+/// The two semaphores of the ping-pong, one for each direction.
+static Semaphore *ping, *pong;
+
+/// Answer every ping with a pong.
+///
+/// * `dummy` is because every forked procedure takes one argument.
+static void
+Ponger(void *dummy)
+{
+    for (unsigned i = 0; i < rounds; i++) {
+        ping->P();
+        pong->V();
+    }
+}
+
+/// Yield `rounds` times.
+///
+/// * `dummy` is because every forked procedure takes one argument.
+static void
+Yielder(void *dummy)
+{
+    for (unsigned i = 0; i < rounds; i++)
+        currentThread->Yield();
+}
+
+/// Print how long it took since `start` and `startTicks` to do `count`
+/// things.
+static void
+Report(const char *what, unsigned count, clock_t start, Ticks startTicks)
+{
+    double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    printf("%u %s in %llu ticks and %.3f seconds (%.3f microseconds"
+           " each).\n", count, what, stats->totalTicks - startTicks, seconds,
+           count > 0 ? seconds * 1e6 / count : 0.0);
+}
+
+/// Bounce between two threads `count` times, then have `YIELDERS` threads
+/// yield `count` times in all, and report how long each took.
+void
+SwitchPerformanceTest(unsigned count)
+{
+    int priority = currentThread->GetPriority();
+
+    printf("Switch performance test: %u semaphore round trips, and %u"
+           " yields among %u threads.\n", count, count, YIELDERS);
+
+    ping   = new Semaphore("ping", 0);
+    pong   = new Semaphore("pong", 0);
+    rounds = count;
+
+    Ticks   startTicks = stats->totalTicks;
+    clock_t start      = clock();
+
+    Thread *ponger = new Thread("ponger", true, priority);
+    ponger->Fork(Ponger, NULL);
+    for (unsigned i = 0; i < count; i++) {
+        ping->V();
+        pong->P();
+    }
+    ponger->Join();
+    delete ponger;
+    Report("round trips", count, start, startTicks);
+
+    delete ping;
+    delete pong;
+
+    Thread *yielders[YIELDERS];
+    rounds     = count / YIELDERS;
+    startTicks = stats->totalTicks;
+    start      = clock();
+
+    for (unsigned i = 0; i < YIELDERS; i++) {
+        yielders[i] = new Thread("yielder", true, priority);
+        yielders[i]->Fork(Yielder, NULL);
+    }
+    for (unsigned i = 0; i < YIELDERS; i++) {
+        yielders[i]->Join();
+        delete yielders[i];
+    }
+    Report("yields", rounds * YIELDERS, start, startTicks);
+}
@@ -34,16 +34,13 @@ Semaphore::Semaphore(const char *debugName, int initialValue)
 {
     name  = debugName;
     value = initialValue;
-    queue = new List<Thread *>;
 }
 
 /// De-allocate semaphore, when no longer needed.
 ///
 /// Assume no one is still waiting on the semaphore!
 Semaphore::~Semaphore()
-{
-    delete queue;
-}
+{}
 
 const char *
 Semaphore::GetName() const
@@ -65,7 +62,7 @@ Semaphore::P()
       // Disable interrupts.
 
     while (value == 0) {  // Semaphore not available.
-        queue->Append(currentThread);  // So go to sleep.
+        queue.Append(currentThread);  // So go to sleep.
         currentThread->Sleep();
     }
     value--;  // Semaphore available, consume its value.
@@ -84,7 +81,7 @@ Semaphore::V()
     Thread   *thread;
     IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
 
-    thread = queue->Pop();
+    thread = queue.Pop();
     if (thread != NULL)  // Make thread ready, consuming the `V` immediately.
         scheduler->ReadyToRun(thread);
     value++;
@@ -99,13 +96,14 @@ Semaphore::V()
 Lock::Lock(const char *debugName)
 {
     name = debugName;
-    semLock = new Semaphore(name, 1);
     threadLock = NULL;
+    nextHeld = NULL;
 }
 
+/// Assume no one holds the lock, or is still waiting for it!
 Lock::~Lock()
 {
-    delete semLock;
+    ASSERT(threadLock == NULL && waiters.IsEmpty());
 }
 
 const char *
@@ -114,32 +112,120 @@ Lock::GetName() const
     return name;
 }
 
+/// Wait until the lock is free, lending our priority to its holder
+/// meanwhile.  `Release` hands the lock straight to the waiter it wakes
+/// up, so no other thread can take it first.
 void
 Lock::Acquire()
 {
     ASSERT(!(IsHeldByCurrentThread()));
-    
-    int currentThreadPriority = currentThread -> GetPriority();
-    if (threadLock != NULL && threadLock -> GetPriority() < currentThreadPriority){
-        threadLock -> ChangePriority(currentThreadPriority);
-        scheduler -> SchChangePriority(threadLock);
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    if (threadLock == NULL)
+        Grant(currentThread);
+    else {
+        currentThread->waitingFor = this;
+        Donate(currentThread->GetPriority());
+        waiters.Append(currentThread);
+        currentThread->Sleep();
     }
-    
-    semLock -> P();
-    threadLock = currentThread;
+    ASSERT(IsHeldByCurrentThread());
+
+    interrupt->SetLevel(oldLevel);
 }
 
+/// Hand the lock on, and yield if we lost priority: a waiter we were
+/// running for may be ready now.
 void
 Lock::Release()
 {
     ASSERT(IsHeldByCurrentThread());
-    
-    if (currentThread -> GetPriority() != currentThread -> GetRealPriority()){
-        scheduler -> SchRestorePriority(currentThread);
-    }
 
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    int oldPriority = currentThread->GetPriority();
+    Unlock();
+    if (currentThread->GetPriority() < oldPriority)
+        currentThread->Yield();
+
+    interrupt->SetLevel(oldLevel);
+}
+
+/// Hand the lock to the waiter of highest priority, if any, and keep only
+/// the priority still lent by the waiters of the other locks we hold.
+void
+Lock::Unlock()
+{
+    Lock **link = &currentThread->heldLocks;
+    while (*link != this)
+        link = &(*link)->nextHeld;
+    *link = nextHeld;
+    nextHeld = NULL;
     threadLock = NULL;
-    semLock -> V();
+
+    Thread *next = HighestWaiter();
+    if (next != NULL) {
+        waiters.Remove(next);
+        next->waitingFor = NULL;
+        Grant(next);
+        UpdatePriority(next);
+        scheduler->ReadyToRun(next);
+    }
+
+    UpdatePriority(currentThread);
+}
+
+Thread *
+Lock::HighestWaiter() const
+{
+    Thread *highest = waiters.Head();
+    for (Thread *t = highest; t != NULL; t = waiters.Next(t))
+        if (t->GetPriority() > highest->GetPriority())
+            highest = t;
+    return highest;
+}
+
+/// Each holder is raised in turn until one already has the priority, which
+/// also ends the walk if the chain loops back, as it does on a deadlock.
+void
+Lock::Donate(int priority)
+{
+    for (Lock *lock = this; lock != NULL; ) {
+        Thread *holder = lock->threadLock;
+        if (holder == NULL || holder->GetPriority() >= priority)
+            break;
+
+        DEBUG('t', "Thread \"%s\" lends priority %d to \"%s\" through"
+              " lock \"%s\"\n", currentThread->GetName(), priority,
+              holder->GetName(), lock->GetName());
+        scheduler->SchChangePriority(holder, priority);
+        lock = holder->waitingFor;
+    }
+}
+
+void
+Lock::Grant(Thread *thread)
+{
+    threadLock = thread;
+    nextHeld = thread->heldLocks;
+    thread->heldLocks = this;
+}
+
+/// The waiters already have any priority lent to them in turn, so looking
+/// one lock deep is enough.
+void
+Lock::UpdatePriority(Thread *thread)
+{
+    int priority = thread->GetRealPriority();
+    for (Lock *lock = thread->heldLocks; lock != NULL; lock = lock->nextHeld) {
+        Thread *waiter = lock->HighestWaiter();
+        if (waiter != NULL && waiter->GetPriority() > priority)
+            priority = waiter->GetPriority();
+    }
+
+    if (priority != thread->GetPriority())
+        scheduler->SchChangePriority(thread, priority);
 }
 
 bool
@@ -152,12 +238,12 @@ Condition::Condition(const char *debugName, Lock *conditionLock)
 {
     name = debugName;
     lockCond = conditionLock;
-    listCond = new List<Semaphore *>;
 }
 
+/// Assume no one is still waiting on the condition variable!
 Condition::~Condition()
 {
-    delete listCond;
+    ASSERT(waiters.IsEmpty());
 }
 
 const char *
@@ -166,22 +252,22 @@ Condition::GetName() const
     return name;
 }
 
+/// Release the lock and go to sleep, in one atomic step, so that a
+/// `Signal` cannot come in between and be lost.  Once woken up, acquire
+/// the lock again.
 void
 Condition::Wait()
 {
     ASSERT(lockCond -> IsHeldByCurrentThread());
-    
-    //semaforo que añadimos a la lista
-    Semaphore *sem = new Semaphore("ConditionSemaphore",0);
-    listCond -> Append(sem);
 
-    //libera al lock
-    lockCond -> Release();
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    waiters.Append(currentThread);
+    lockCond->Unlock();
+    currentThread->Sleep();
+
+    interrupt->SetLevel(oldLevel);
 
-    //se bloquea hasta recibir una notificación de otro hilo
-    sem -> P();
-    
-    // vuelve a adquirir el lock
     lockCond -> Acquire();
 }
 
@@ -190,18 +276,29 @@ Condition::Signal()
 {
     ASSERT(lockCond -> IsHeldByCurrentThread());
 
-    if (!(listCond -> IsEmpty()))
-        (listCond -> Pop()) -> V();
-        
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    Thread *thread = waiters.Pop();
+    if (thread != NULL)
+        scheduler->ReadyToRun(thread);
+
+    interrupt->SetLevel(oldLevel);
 }
 
+/// Every waiter is made ready in a single pass, with interrupts disabled
+/// only once.
 void
 Condition::Broadcast()
 {
     ASSERT(lockCond -> IsHeldByCurrentThread());
 
-    while (!(listCond -> IsEmpty()))
-        (listCond -> Pop()) -> V();
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    Thread *thread;
+    while ((thread = waiters.Pop()) != NULL)
+        scheduler->ReadyToRun(thread);
+
+    interrupt->SetLevel(oldLevel);
 }
 
 Port::Port(const char *debugName)
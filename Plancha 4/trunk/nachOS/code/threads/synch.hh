@@ -64,7 +64,7 @@ private:
     int value;
 
     /// Queue of threads waiting on `P` because the value is zero.
-    List<Thread *> *queue;
+    ThreadList queue;
 
 };
 
@@ -79,6 +79,12 @@ private:
 ///
 /// For convenience, nobody but the thread that holds the lock can free it.
 /// There is no operation for reading the state of the lock.
+///
+/// To keep a thread from waiting on one of lower priority, a thread that
+/// waits for a lock lends its priority to the holder, and on to whatever
+/// lock the holder waits for in turn.  A thread keeps the highest priority
+/// lent by the waiters of all the locks it holds, and loses only the part
+/// that it no longer owes them when it releases one.
 class Lock {
 public:
 
@@ -110,8 +116,32 @@ private:
     // Hilo que posee el lock.
     Thread *threadLock;
 
-    // Defino un semaforo para usarlo como base.
-    Semaphore *semLock;
+    /// Threads waiting to acquire the lock, in the order they came.
+    ThreadList waiters;
+
+    /// Next lock held by the same thread (see `Thread::heldLocks`).
+    Lock *nextHeld;
+
+    /// The waiter of highest priority, the first one among equals; `NULL`
+    /// if none.
+    Thread *HighestWaiter() const;
+
+    /// Lend `priority` to the holder of the lock, and down the chain of
+    /// locks that holders wait for.
+    void Donate(int priority);
+
+    /// Make `thread` the holder of the lock.
+    void Grant(Thread *thread);
+
+    /// Release the lock without yielding.  Interrupts must be disabled.
+    void Unlock();
+
+    /// `Condition::Wait` releases the lock and goes to sleep atomically.
+    friend class Condition;
+
+    /// Give `thread` the highest of its own priority and the priorities of
+    /// the waiters of the locks it holds.
+    static void UpdatePriority(Thread *thread);
 };
 
 // This class defined a “condition variable”.
@@ -172,8 +202,10 @@ private:
     // Defino un lock para usarlo como base.
     Lock *lockCond;
 
-    // Lista de los que están en espera.
-    List <Semaphore *> *listCond;
+    /// Threads waiting on the condition, in the order they came.  A thread
+    /// waits on one queue at a time, so it is linked in through its own
+    /// `Thread::queueLink`, and waiting allocates nothing.
+    ThreadList waiters;
 };
 
 // Clase Port. Implementa el paso de mensajes entre hilos a traves de puertos,
@@ -7,7 +7,9 @@
 
 
 #include "system.hh"
+#include "fair_share_policy.hh"
 #include "preemptive.hh"
+#include "priority_policy.hh"
 
 
 /// This defines *all* of the global data structures used by Nachos.
@@ -17,6 +19,7 @@
 Thread *currentThread;           ///< The thread we are running now.
 Thread *threadToBeDestroyed;     ///< The thread that just finished.
 Scheduler *scheduler;            ///< The ready list.
+StackPool *stackPool;            ///< Stacks of finished threads, for reuse.
 Interrupt *interrupt;            ///< Interrupt status.
 Statistics *stats;               ///< Performance metrics.
 Timer *timer;                    ///< The hardware timer device, for invoking
@@ -25,7 +28,11 @@ Thread *threadsPid[MAX_PID_THREADS]; ///< Lista de threads cuyo pid es el indice
 
 // 2007, Jose Miguel Santos Espino
 PreemptiveScheduler *preemptiveScheduler = NULL;
-const long long DEFAULT_TIME_SLICE = 50000;
+const long long DEFAULT_TIME_SLICE = 50000;     ///< Host instructions.
+const long long DEFAULT_SIGNAL_SLICE = 10000;   ///< Microseconds.
+
+/// Free thread stacks kept for reuse, by default.
+const unsigned DEFAULT_STACK_POOL = 16;
 
 #ifdef FILESYS_NEEDED
 FileSystem *fileSystem;
@@ -40,6 +47,7 @@ SynchDisk *synchDisk;
 Machine *machine;  ///< User program memory and registers.
 SynchConsole *synchConsole;
 BitMap *bitMap;
+Profiler *profiler;
 #endif
 
 #ifdef VMEM
@@ -53,6 +61,12 @@ PostOffice *postOffice;
 // External definition, to allow us to take a pointer to this function.
 extern void Cleanup();
 
+#ifdef USER_PROGRAM
+#include "userprog/snapshot.hh"
+static const char *snapshotFile;  ///< Where to save a snapshot, if anywhere.
+static Ticks snapshotTicks;       ///< When to save it, at the earliest.
+#endif
+
 /// Interrupt handler for the timer device.
 ///
 /// The timer device is set up to interrupt the CPU periodically (once every
@@ -70,8 +84,36 @@ extern void Cleanup();
 static void
 TimerInterruptHandler(void *dummy)
 {
-    if (interrupt->GetStatus() != IDLE_MODE)
+    bool yield = interrupt->GetStatus() != IDLE_MODE
+                 && scheduler->SliceExpired();
+    if (yield)
         interrupt->YieldOnReturn();
+#ifdef USER_PROGRAM
+    // Keep trying until the system is in a state that can be saved.
+    if (snapshotFile != NULL && stats->totalTicks >= snapshotTicks
+          && TakeSnapshot(snapshotFile, yield))
+        snapshotFile = NULL;
+#endif
+}
+
+/// Return a new scheduling policy, given its name in `-sched`.
+static SchedulingPolicy *
+NewSchedulingPolicy(const char *name)
+{
+    ASSERT(name != NULL);
+
+    if (!strcmp(name, "priority"))
+        return new PriorityPolicy(false);
+    if (!strcmp(name, "mlfq"))
+        return new PriorityPolicy(true);
+    if (!strcmp(name, "stride"))
+        return new StridePolicy;
+    if (!strcmp(name, "fair"))
+        return new FairPolicy;
+
+    printf("Unknown scheduling policy %s\n", name);
+    ASSERT(false);
+    return NULL;
 }
 
 /// Initialize Nachos global data structures.
@@ -94,13 +136,24 @@ Initialize(int argc, char **argv)
     int argCount;
     const char *debugArgs = "";
     bool randomYield = false;
+    bool dynamicTicks = false;  // Stop the timer when it is not needed.
+    const char *policyName = "priority";  // How to choose ready threads.
+    unsigned stackPoolSize = DEFAULT_STACK_POOL;  // Free stacks to keep.
 
     // 2007, Jose Miguel Santos Espino
     bool preemptiveScheduling = false;
+    bool preemptWithPtrace = false;
     long long timeSlice;
 
 #ifdef USER_PROGRAM
     bool debugUserProg = false;  // Single step user program.
+    bool threadedCode = false;   // Run user programs by basic blocks.
+    unsigned jitThreshold = 0;   // Translate blocks run this many times.
+    unsigned profilePeriod = 0;  // Ticks between profiler samples.
+    const char *statsFile = NULL;  // Where to write statistics as JSON.
+    unsigned pageSize = DEFAULT_PAGE_SIZE;  // Bytes in a page.
+    unsigned memorySize = DEFAULT_NUM_PHYS_PAGES * DEFAULT_PAGE_SIZE;
+      // Bytes of main memory.
 #endif
 #ifdef FILESYS_NEEDED
     bool format = false;  // Format disk.
@@ -126,11 +179,25 @@ Initialize(int argc, char **argv)
             randomYield = true;
             argCount = 2;
         }
+        else if (!strcmp(*argv, "-dt"))
+            dynamicTicks = true;
+        else if (!strcmp(*argv, "-sched")) {
+            ASSERT(argc > 1);
+            policyName = *(argv + 1);
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-sp")) {
+            ASSERT(argc > 1);
+            stackPoolSize = atoi(*(argv + 1));
+            argCount = 2;
+        }
         // 2007, Jose Miguel Santos Espino
-        else if (!strcmp(*argv, "-p")) {
+        else if (!strcmp(*argv, "-p") || !strcmp(*argv, "-pt")) {
             preemptiveScheduling = true;
-            if (argc == 1) {
-                timeSlice = DEFAULT_TIME_SLICE;
+            preemptWithPtrace = !strcmp(*argv, "-pt");
+            if (argc == 1 || **(argv + 1) == '-') {
+                timeSlice = preemptWithPtrace ? DEFAULT_TIME_SLICE
+                                              : DEFAULT_SIGNAL_SLICE;
             } else {
                 timeSlice = atoi(*(argv+1));
                 argCount = 2;
@@ -139,6 +206,41 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s"))
             debugUserProg = true;
+        else if (!strcmp(*argv, "-bb"))
+            threadedCode = true;
+        else if (!strcmp(*argv, "-jit")) {
+            threadedCode = true;
+            if (argc == 1 || **(argv + 1) == '-')
+                jitThreshold = DEFAULT_JIT_THRESHOLD;
+            else {
+                jitThreshold = atoi(*(argv + 1));
+                argCount = 2;
+            }
+        } else if (!strcmp(*argv, "-prof")) {
+            if (argc == 1 || **(argv + 1) == '-')
+                profilePeriod = DEFAULT_PROFILE_PERIOD;
+            else {
+                profilePeriod = atoi(*(argv + 1));
+                argCount = 2;
+            }
+        } else if (!strcmp(*argv, "-js")) {
+            ASSERT(argc > 1);
+            statsFile = *(argv + 1);
+            argCount = 2;
+        } else if (!strcmp(*argv, "-snap")) {
+            ASSERT(argc > 2);
+            snapshotFile = *(argv + 1);
+            snapshotTicks = strtoull(*(argv + 2), NULL, 10);
+            argCount = 3;
+        } else if (!strcmp(*argv, "-mem")) {
+            ASSERT(argc > 1);
+            memorySize = atoi(*(argv + 1)) * 1024;
+            argCount = 2;
+        } else if (!strcmp(*argv, "-ps")) {
+            ASSERT(argc > 1);
+            pageSize = atoi(*(argv + 1));
+            argCount = 2;
+        }
 #endif
 #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f"))
@@ -159,8 +261,15 @@ Initialize(int argc, char **argv)
 
     DebugInit(debugArgs);                                     // Initialize `DEBUG` messages.
     stats = new Statistics();                                 // Collect statistics.
+#ifdef USER_PROGRAM
+    stats->jsonFile = statsFile;
+    if (snapshotFile != NULL)
+        dynamicTicks = false;  // Snapshots are taken from the timer.
+#endif
     interrupt = new Interrupt;                                // Start up interrupt handling.
-    scheduler = new Scheduler();                              // Initialize the ready queue.
+    scheduler = new Scheduler(NewSchedulingPolicy(policyName),
+                              dynamicTicks);                  // Initialize the ready queue.
+    stackPool = new StackPool(stackPoolSize);                 // Recycle thread stacks.
     timer = new Timer(TimerInterruptHandler, 0, randomYield); //Start the timer.
 
     threadToBeDestroyed = NULL;
@@ -170,6 +279,7 @@ Initialize(int argc, char **argv)
     // object to save its state.
     currentThread = new Thread("main", false, 9);
     currentThread->SetStatus(RUNNING);
+    scheduler->UpdateTimer();  // Nothing else is ready yet.
 
     interrupt->Enable();
     CallOnUserAbort(Cleanup);  // If user hits ctl-C...
@@ -177,7 +287,10 @@ Initialize(int argc, char **argv)
     // Jose Miguel Santos Espino, 2007
     if (preemptiveScheduling) {
         preemptiveScheduler = new PreemptiveScheduler();
-        preemptiveScheduler->SetUp(timeSlice);
+        if (preemptWithPtrace)
+            preemptiveScheduler->SetUp(timeSlice);
+        else
+            preemptiveScheduler->SetUpSignals(timeSlice);
     }
 
     for (unsigned i = 0; i < MAX_PID_THREADS; i++)
@@ -185,13 +298,21 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     Debugger *d = debugUserProg ? new Debugger : NULL;
-    machine = new Machine(d);  // This must come first.
+    ASSERT(pageSize != 0 && memorySize % pageSize == 0);
+    // Generated code cannot be preempted asynchronously by the `ptrace`
+    // scheduler, so there is no translating with `-pt`.  Signals only
+    // switch threads between blocks.
+    machine = new Machine(d, threadedCode,
+                          preemptWithPtrace ? 0 : jitThreshold,
+                          memorySize / pageSize, pageSize);
+      // This must come first.
     synchConsole = new SynchConsole(NULL, NULL);
-    bitMap = new BitMap(NUM_PHYS_PAGES);
+    bitMap = new BitMap(machine->numPhysPages);
+    profiler = profilePeriod != 0 ? new Profiler(profilePeriod) : NULL;
 #endif
 
 #ifdef VMEM
-    coreMap = new CoreMap();
+    coreMap = new CoreMap(machine->numPhysPages);
 #endif
 
 #ifdef FILESYS
@@ -224,6 +345,7 @@ Cleanup()
     delete machine;
     delete synchConsole;
     delete bitMap;
+    delete profiler;
 #endif
 
 #ifdef VMEM
@@ -239,6 +361,7 @@ Cleanup()
 #endif
 
     delete timer;
+    delete stackPool;
     delete scheduler;
     delete interrupt;
 
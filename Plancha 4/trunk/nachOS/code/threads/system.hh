@@ -11,6 +11,7 @@
 
 #include "thread.hh"
 #include "scheduler.hh"
+#include "stack_pool.hh"
 #include "lib/utility.hh"
 #include "machine/interrupt.hh"
 #include "machine/statistics.hh"
@@ -32,6 +33,7 @@ extern void Cleanup();
 extern Thread *currentThread;               ///< The thread holding the CPU.
 extern Thread *threadToBeDestroyed;         ///< The thread that just finished.
 extern Scheduler *scheduler;                ///< The ready list.
+extern StackPool *stackPool;                ///< Free thread stacks.
 extern Interrupt *interrupt;                ///< Interrupt status.
 extern Statistics *stats;                   ///< Performance metrics.
 extern Timer *timer;                        ///< The hardware alarm clock.
@@ -50,6 +52,9 @@ extern SynchConsole* synchConsole; // Consola sincrona
 
 #include "lib/bitmap.hh"
 extern BitMap *bitMap; // BitMap para multiprogramacion
+
+#include "userprog/profiler.hh"
+extern Profiler *profiler;  // Sampling profiler, `NULL` if not profiling.
 #endif
 
 #ifdef VMEM
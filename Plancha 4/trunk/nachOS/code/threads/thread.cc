@@ -49,6 +49,11 @@ Thread::Thread(const char *threadName, bool callsJoin, int prior)
     stackTop = NULL;
     stack    = NULL;
     status   = JUST_CREATED;
+    virtualTime = 0;
+    runTicks    = 0;
+    finishTicks = 0;
+    heldLocks   = NULL;
+    waitingFor  = NULL;
 #ifdef USER_PROGRAM
     space    = NULL;
     for(int i = 2; i < NUM_MAX_FILES; i++) 
@@ -65,13 +70,25 @@ Thread::Thread(const char *threadName, bool callsJoin, int prior)
 /// NOTE: if this is the main thread, we cannot delete the stack because we
 /// did not allocate it -- we got it automatically as part of starting up
 /// Nachos.
+///
+/// The stack goes back to `stackPool`, once checked for overflows.
 Thread::~Thread()
 {
     DEBUG('t', "Deleting thread \"%s\"\n", name);
 
     ASSERT(this != currentThread);
-    if (stack != NULL)
-        DeallocBoundedArray((char *) stack, STACK_SIZE * sizeof *stack);
+    ASSERT(!queueLink.IsLinked());
+#ifdef USER_PROGRAM
+    // `Exec` gives a thread a second pid; neither may outlive it.
+    for (SpaceId pid; (pid = GetSpId(this)) != -1; )
+        RemoveThread(pid);
+#endif
+    if (stack != NULL) {
+        CheckOverflow();
+        stackPool->Put(stack);
+    }
+    if (joinFlag)
+        delete threadPort;
 }
 
 /// Invoke `(*func)(arg)`, allowing caller and callee to execute
@@ -97,10 +114,10 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
 
 #ifdef HOST_x86_64
     DEBUG('t', "Forking thread \"%s\" with func = 0x%lX, arg = %ld\n",
-          name, (HostMemoryAddress) func, arg);
+          name, (HostMemoryAddress) func, (long) arg);
 #else
     DEBUG('t', "Forking thread \"%s\" with func = 0x%X, arg = %d\n",
-          name, (HostMemoryAddress) func, arg);
+          name, (HostMemoryAddress) func, (int) arg);
 #endif
 
     StackAllocate(func, arg);
@@ -111,6 +128,8 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     interrupt->SetLevel(oldLevel);
 }
 
+/// Once it returns, the thread is done and off its stack, so the caller
+/// may delete it (threads that are joined are not deleted by `Finish`).
 void
 Thread::Join()
 {
@@ -147,6 +166,12 @@ Thread::SetStatus(ThreadStatus st)
     status = st;
 }
 
+ThreadStatus
+Thread::GetStatus() const
+{
+    return status;
+}
+
 const char *
 Thread::GetName() const
 {
@@ -183,6 +208,14 @@ Thread::ChangePriority(int prior)
     priority = prior;
 }
 
+void
+Thread::SetBasePriority(int prior)
+{
+    if (priority == realPriority || priority < prior)
+        priority = prior;
+    realPriority = prior;
+}
+
 void
 Thread::Print() const
 {
@@ -207,12 +240,16 @@ Thread::Finish(int st)
     ASSERT(this == currentThread);
 
     #ifdef USER_PROGRAM
-    RemoveThread(GetSpId(this));
+    // A joined thread keeps its pids until it is deleted, so that a `Join`
+    // made after it exits still finds it.
+    if (!joinFlag)
+        RemoveThread(GetSpId(this));
     for(int i = 2; i < NUM_MAX_FILES; i++) 
         ofilesids[i] = NULL;
     #endif
 
     DEBUG('t', "Finishing thread \"%s\"\n", GetName());
+    finishTicks = stats->totalTicks;
     
     if (joinFlag)
         threadPort -> Send(st);
@@ -221,6 +258,7 @@ Thread::Finish(int st)
 
     #ifdef USER_PROGRAM
     delete this -> space;
+    space = NULL;  // So that switching away does not save into it.
     #endif
 
     Sleep();  // Invokes `SWITCH`.
@@ -311,6 +349,9 @@ InterruptEnable()
 
 /// Allocate and initialize an execution stack.
 ///
+/// The stack comes from `stackPool`, and may have been used by a thread
+/// that is done.
+///
 /// The stack is initialized with an initial stack frame for `ThreadRoot`,
 /// which:
 /// 1. enables interrupts;
@@ -324,8 +365,7 @@ Thread::StackAllocate(VoidFunctionPtr func, void *arg)
 {
     ASSERT(func != NULL);
 
-    stack = (HostMemoryAddress *) AllocBoundedArray(STACK_SIZE
-                                                    * sizeof *stack);
+    stack = stackPool->Get();
 
     // i386 & MIPS & SPARC stack works from high addresses to low addresses.
     stackTop = stack + STACK_SIZE - 4;  // -4 to be on the safe side!
@@ -39,7 +39,9 @@
 #define NACHOS_THREADS_THREAD__HH
 
 
+#include "lib/intrusive_list.hh"
 #include "lib/utility.hh"
+#include "machine/statistics.hh"
 
 #ifdef USER_PROGRAM
 #include "machine/machine.hh"
@@ -49,6 +51,7 @@
 #endif
 
 class Port;
+class Lock;
 
 /// CPU register state to be saved on context switch.
 ///
@@ -129,6 +132,8 @@ public:
 
     void SetStatus(ThreadStatus st);
 
+    ThreadStatus GetStatus() const;
+
     const char *GetName() const;
 
     // Obtiene la bandera para el join.
@@ -142,8 +147,32 @@ public:
 
     void ChangePriority(int prior);
 
+    /// Make `prior` the priority of the thread, keeping any higher one it
+    /// has been lent by a thread waiting for its lock.
+    void SetBasePriority(int prior);
+
     void Print() const;
 
+    /// Links the thread into the one queue it may be waiting in: a ready
+    /// list of the scheduler, or the queue of a semaphore, a lock or a
+    /// condition variable (see `ThreadList`).
+    ListLink<Thread> queueLink;
+
+    /// How far the thread is in its share of the CPU, for the fair-share
+    /// scheduling policies (see `FairSharePolicy`).
+    unsigned long long virtualTime;
+
+    /// Busy ticks the thread has run, and when it finished (0 until then).
+    Ticks runTicks;
+    Ticks finishTicks;
+
+    /// Locks the thread holds, linked through `Lock::nextHeld`, and the
+    /// lock it is waiting to acquire, if any; `NULL` if none.  With them,
+    /// `Lock` lends the priority of a waiting thread down the whole chain
+    /// of holders, and works out what is left of it on release.
+    Lock *heldLocks;
+    Lock *waitingFor;
+
 private:
     // Some of the private data for this class is listed above.
 
@@ -200,6 +229,10 @@ public:
 #endif
 };
 
+/// A queue of threads, linked through `Thread::queueLink`, so that
+/// queueing a thread does not allocate memory.
+typedef IntrusiveList<Thread, &Thread::queueLink> ThreadList;
+
 /// Magical machine-dependent routines, defined in `switch.s`.
 
 extern "C" {
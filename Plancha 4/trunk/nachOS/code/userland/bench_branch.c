@@ -0,0 +1,27 @@
+/// Benchmark with many short, data dependent branches.
+///
+/// Counts the steps of the Collatz sequence of every number below `LIMIT`,
+/// so that the interpreter spends its time deciding which way to go rather
+/// than doing arithmetic or touching memory.
+
+
+#include "syscall.h"
+
+
+#define LIMIT  3000
+
+int
+main(void)
+{
+    int i, n, steps;
+
+    for (steps = 0, i = 1; i < LIMIT; i++)
+        for (n = i; n != 1; steps++)
+            if (n & 1)
+                n = 3 * n + 1;
+            else
+                n >>= 1;
+
+    // Should be 215015.
+    Exit(steps);
+}
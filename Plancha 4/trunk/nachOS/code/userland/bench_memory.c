@@ -0,0 +1,42 @@
+/// Benchmark made mostly of loads and stores, of every width.
+///
+/// Copies a buffer back and forth as bytes, half words and words, and
+/// checks the result, so that memory accesses and their translation
+/// dominate.
+
+
+#include "syscall.h"
+
+
+#define SIZE    2048  // Bytes in each buffer.
+#define PASSES  8
+
+/// Words, so that the half word and word accesses are aligned.
+static int src[SIZE / 4];
+static int dst[SIZE / 4];
+
+int
+main(void)
+{
+    int i, p, sum;
+    char  *bs = (char *) src,  *bd = (char *) dst;
+    short *hs = (short *) src, *hd = (short *) dst;
+
+    for (i = 0; i < SIZE; i++)
+        bs[i] = i;
+
+    for (p = 0; p < PASSES; p++) {
+        for (i = 0; i < SIZE; i++)
+            bd[i] = bs[i];
+        for (i = 0; i < SIZE / 2; i++)
+            hs[i] = hd[i];
+        for (i = 0; i < SIZE / 4; i++)
+            dst[i] = src[i];
+    }
+
+    for (sum = 0, i = 0; i < SIZE; i++)
+        sum += bd[i] - bs[i];
+
+    // And then we are done -- should be 0!
+    Exit(sum);
+}
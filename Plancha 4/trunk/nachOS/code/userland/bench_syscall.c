@@ -0,0 +1,21 @@
+/// Benchmark that traps into the kernel over and over.
+///
+/// Each call writes nothing to the console, so what gets measured is the
+/// round trip through the exception handler rather than any device.
+
+
+#include "syscall.h"
+
+
+#define CALLS  5000
+
+int
+main(void)
+{
+    char buffer[1];
+    int  i;
+
+    for (i = 0; i < CALLS; i++)
+        Write(buffer, 0, ConsoleOutput);
+    Exit(0);
+}
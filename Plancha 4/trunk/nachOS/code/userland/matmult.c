@@ -10,7 +10,12 @@
 
 
 /// Sum total of the arrays does not fit in physical memory.
+///
+/// Other sizes can be chosen when compiling; the benchmarks use `-DDIM=10`
+/// and `-DDIM=30` too.
+#ifndef DIM
 #define DIM  20
+#endif
 
 static int A[DIM][DIM];
 static int B[DIM][DIM];
@@ -0,0 +1,37 @@
+/// Paging benchmark: sweep an array bigger than the default main memory.
+///
+/// Every pass writes each word of `data` in order, then reads them all
+/// back.  Run it with different sizes of memory and of pages, as in
+///
+///     nachos -mem 16 -ps 256 -x page_sweep
+///
+/// and compare the page faults in the statistics.  With less memory than
+/// the array, pages are evicted in the order they came in, so every sweep
+/// faults each page in again; bigger pages mean fewer faults, each of them
+/// moving more bytes.  Swapping does not go through the simulated disk, so
+/// the ticks hardly change.
+
+
+#include "syscall.h"
+
+
+#define SIZE    (32 * 1024 / 4)  // 32 KB of words.
+#define PASSES  4
+
+static int data[SIZE];
+
+int
+main(void)
+{
+    int i, p, sum;
+
+    for (p = 0; p < PASSES; p++) {
+        for (i = 0; i < SIZE; i++)
+            data[i] = i + p;
+        for (sum = 0, i = 0; i < SIZE; i++)
+            sum += data[i];
+        if (sum != SIZE * (SIZE - 1) / 2 + p * SIZE)
+            Exit(1);
+    }
+    Exit(0);
+}
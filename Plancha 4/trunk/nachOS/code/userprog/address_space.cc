@@ -19,6 +19,7 @@
 #include "address_space.hh"
 #include "threads/system.hh"
 #include "machine/machine.hh"
+#include "snapshot.hh"
 
 /// Do little endian to big endian conversion on the bytes in the object file
 /// header, in case the file was generated on a little endian machine, and we
@@ -54,22 +55,20 @@ SwapHeader(noffHeader *noffH)
 ///
 /// * `executable` is the file containing the object code to load into
 ///   memory.
-AddressSpace::AddressSpace(OpenFile *exec, int pid)
+/// * `name` is the name of that file.
+AddressSpace::AddressSpace(OpenFile *exec, const char *name, int pid)
 {
     executable = exec;
     ASSERT(executable != NULL);
+    ASSERT(name != NULL);
     unsigned   size;
+    unsigned   pageSize = machine->pageSize;
 
+    fileName = new char[strlen(name) + 1];
+    strcpy(fileName, name);
     asid = pid;
     #ifdef VMEM
-    char swapName[8];
-
-    DEBUG('c', "Inicializando swap\n");
-
-    sprintf(swapName, "SWAP.%d", asid);
-    ASSERT(fileSystem -> Create(swapName, 0));
-    swap = fileSystem -> Open(swapName);
-    
+    CreateSwap();
     DEBUG('c', "Inicializando space\n");
     #endif
 
@@ -84,12 +83,14 @@ AddressSpace::AddressSpace(OpenFile *exec, int pid)
     size = noffH.code.size + noffH.initData.size + noffH.uninitData.size
            + USER_STACK_SIZE;
       // We need to increase the size to leave room for the stack.
-    numPages = divRoundUp(size, PAGE_SIZE);
-    size = numPages * PAGE_SIZE;
+    numPages = divRoundUp(size, pageSize);
+    size = numPages * pageSize;
 
+    #ifndef USE_DL
     ASSERT(numPages <= bitMap -> NumClear());
       // Check we are not trying to run anything too big -- at least until we
       // have virtual memory.
+    #endif
 
     DEBUG('a', "Initializing address space, num pages %u, size %u\n",
           numPages, size);
@@ -121,7 +122,7 @@ AddressSpace::AddressSpace(OpenFile *exec, int pid)
     // Zero out the entire address space, to zero the unitialized data
     // segment and the stack segment.
     for (unsigned i = 0; i < numPages; i++) {
-        memset(&(machine->mainMemory[pageTable[i].physicalPage*PAGE_SIZE]), 0, PAGE_SIZE);
+        memset(&(machine->mainMemory[pageTable[i].physicalPage*pageSize]), 0, pageSize);
     }
 
     // Then, copy in the code and data segments into memory.
@@ -132,9 +133,9 @@ AddressSpace::AddressSpace(OpenFile *exec, int pid)
         int vaddr, ppage, offset;
         for (unsigned i = 0; i < noffH.code.size; i++) {
             vaddr = (noffH.code.virtualAddr + i);
-            ppage = pageTable[vaddr / PAGE_SIZE].physicalPage;
-            offset = vaddr % PAGE_SIZE;
-            executable -> ReadAt(&(machine -> mainMemory[ppage * PAGE_SIZE + offset]), 1, noffH.code.inFileAddr + i);
+            ppage = pageTable[vaddr / pageSize].physicalPage;
+            offset = vaddr % pageSize;
+            executable -> ReadAt(&(machine -> mainMemory[ppage * pageSize + offset]), 1, noffH.code.inFileAddr + i);
         }
         //executable->ReadAt(&(machine->mainMemory[noffH.code.virtualAddr]),
         //                   noffH.code.size, noffH.code.inFileAddr);
@@ -146,9 +147,9 @@ AddressSpace::AddressSpace(OpenFile *exec, int pid)
         int vaddr, ppage, offset;
         for (unsigned i = 0; i < noffH.initData.size; i++) {
             vaddr = (noffH.initData.virtualAddr + i);
-            ppage = pageTable[vaddr / PAGE_SIZE].physicalPage;
-            offset = vaddr % PAGE_SIZE;
-            executable -> ReadAt(&(machine -> mainMemory[ppage * PAGE_SIZE + offset]), 1, noffH.initData.inFileAddr + i);
+            ppage = pageTable[vaddr / pageSize].physicalPage;
+            offset = vaddr % pageSize;
+            executable -> ReadAt(&(machine -> mainMemory[ppage * pageSize + offset]), 1, noffH.initData.inFileAddr + i);
         }
         //executable->ReadAt(
         //  &(machine->mainMemory[noffH.initData.virtualAddr]),
@@ -158,6 +159,52 @@ AddressSpace::AddressSpace(OpenFile *exec, int pid)
 
 }
 
+/// Recreate an address space from a snapshot.
+///
+/// Pages that were in memory come back with the rest of physical memory
+/// (see `Machine::Restore`); pages in swap are written to a new swap file;
+/// pages never loaded are still loaded on demand, so the executable is
+/// opened again by name.
+AddressSpace::AddressSpace(Snapshot *snapshot, int pid)
+{
+    ASSERT(snapshot != NULL);
+
+    unsigned length;
+
+    snapshot->Read(&length, sizeof length);
+    fileName = new char[length + 1];
+    snapshot->Read(fileName, length);
+    fileName[length] = '\0';
+    asid = pid;
+
+    #ifdef USE_DL
+    executable = fileSystem->Open(fileName);
+    ASSERT(executable != NULL);
+    #else
+    executable = NULL;  // Every page was loaded when it was created.
+    #endif
+
+    snapshot->Read(&noffH, sizeof noffH);
+    snapshot->Read(&numPages, sizeof numPages);
+    pageTable = new TranslationEntry[numPages];
+    states = new States[numPages];
+    snapshot->Read(pageTable, numPages * sizeof *pageTable);
+    snapshot->Read(states, numPages * sizeof *states);
+
+    #ifdef VMEM
+    unsigned  pageSize = machine->pageSize;
+    char     *page = new char[pageSize];
+
+    CreateSwap();
+    for (unsigned i = 0; i < numPages; i++)
+        if (states[i] == IN_SWAP) {
+            snapshot->Read(page, pageSize);
+            swap->WriteAt(page, pageSize, i * pageSize);
+        }
+    delete [] page;
+    #endif
+}
+
 /// Deallocate an address space.
 ///
 /// Nothing for now!
@@ -165,13 +212,18 @@ AddressSpace::~AddressSpace()
 {
     for (unsigned i = 0; i < numPages; i++)
     {
+        if (! pageTable[i].valid)
+            continue;  // Never loaded, so there is no frame to give back.
         #ifdef VMEM
         coreMap -> Clear(pageTable[i].physicalPage);
         #endif
+        machine -> InvalidateDecodedPage(pageTable[i].physicalPage);
         bitMap -> Clear(pageTable[i].physicalPage);
     }
+    machine -> FlushSoftTlb();  // It may point into `pageTable`.
     delete [] pageTable;
     delete [] states;
+    delete [] fileName;
 }
 
 /// Set the initial values for the user-level register set.
@@ -196,9 +248,9 @@ AddressSpace::InitRegisters()
     // Set the stack register to the end of the address space, where we
     // allocated the stack; but subtract off a bit, to make sure we do not
     // accidentally reference off the end!
-    machine->WriteRegister(STACK_REG, numPages * PAGE_SIZE - 16);
+    machine->WriteRegister(STACK_REG, numPages * machine->pageSize - 16);
     DEBUG('a', "Initializing stack register to %u\n",
-          numPages * PAGE_SIZE - 16);
+          numPages * machine->pageSize - 16);
 }
 
 /// On a context switch, save any machine state, specific to this address
@@ -214,6 +266,9 @@ AddressSpace::SaveState()
     {
         if (machine -> tlb[i].valid) //TODO: && machine -> tlb[i].dirty?
             pageTable[machine -> tlb[i].virtualPage] = machine -> tlb[i];
+        // An Exec'd thread preempted before its first `RestoreState` saves
+        // into its space too; it must not find the previous space's entries.
+        machine -> tlb[i].valid = false;
     }
     #endif
 }
@@ -234,6 +289,7 @@ AddressSpace::RestoreState()
     machine->pageTable     = pageTable;
     machine->pageTableSize = numPages;
     #endif
+    machine -> FlushSoftTlb();
 }
 
 TranslationEntry *
@@ -242,6 +298,12 @@ AddressSpace::GetPT(int page)
     return &pageTable[page]; 
 }
 
+const char *
+AddressSpace::GetFileName() const
+{
+    return fileName;
+}
+
 unsigned 
 AddressSpace::GetNumPages()
 {
@@ -258,7 +320,9 @@ AddressSpace::VPNControl(unsigned vpn)
 void
 AddressSpace::LoadVPNFromBinary(unsigned vpn, int physPage)
 {
-    for (unsigned vaddr = vpn * PAGE_SIZE, i = 0; vaddr < (vpn + 1) * PAGE_SIZE; vaddr++, i++)
+    unsigned pageSize = machine -> pageSize;
+
+    for (unsigned vaddr = vpn * pageSize, i = 0; vaddr < (vpn + 1) * pageSize; vaddr++, i++)
     {
         char c;
         unsigned offset;
@@ -272,7 +336,7 @@ AddressSpace::LoadVPNFromBinary(unsigned vpn, int physPage)
             offset = vaddr - noffH.initData.virtualAddr;
             executable -> ReadAt(&c, 1, noffH.initData.inFileAddr + offset);
         }
-        machine -> mainMemory[physPage * PAGE_SIZE + i] = c;
+        machine -> mainMemory[physPage * pageSize + i] = c;
     }
 }
 
@@ -285,6 +349,7 @@ AddressSpace::InsertTLB(unsigned vpn)
 
     if (! pT -> valid)
     {
+        stats -> numPageFaults ++;
         #ifdef VMEM
         physPage = coreMap -> Find(this, vpn);
         #else
@@ -334,6 +399,7 @@ AddressSpace::InsertTLB(unsigned vpn)
     machine -> tlb[newval].readOnly     = pT -> readOnly;
     machine -> tlb[newval].use          = pT -> use;
     machine -> tlb[newval].dirty        = pT -> dirty;
+    machine -> FlushSoftTlb();
     DEBUG('b', "Termino la modificacion de la tlb\n");
 }
 
@@ -342,26 +408,74 @@ AddressSpace::SaveToSwap(unsigned vpn)
 {
     DEBUG('c', "Guardando %d a swap\n", vpn);
     unsigned ppn = pageTable[vpn].physicalPage;
-    swap -> WriteAt(&machine -> mainMemory[ppn * PAGE_SIZE], PAGE_SIZE, vpn * PAGE_SIZE);
+    unsigned pageSize = machine -> pageSize;
+    swap -> WriteAt(&machine -> mainMemory[ppn * pageSize], pageSize, vpn * pageSize);
     
     #ifdef USE_TLB
-    DEBUG('c', "Invalidando la tlb\n");
-    for (unsigned i = 0; i < TLB_SIZE; i++)
+    // The TLB only holds entries of the running process.
+    if (currentThread -> space == this)
     {
-        if (machine -> tlb[i].valid && machine -> tlb[i].virtualPage == vpn)
-            machine -> tlb[i].valid = false;
+        DEBUG('c', "Invalidando la tlb\n");
+        for (unsigned i = 0; i < TLB_SIZE; i++)
+        {
+            if (machine -> tlb[i].valid && machine -> tlb[i].virtualPage == vpn)
+                machine -> tlb[i].valid = false;
+        }
     }
     #endif
+    machine -> FlushSoftTlb();
     
     states[vpn] = IN_SWAP;
-    //pageTable[vpn].valid = false; //TODO: borrar?
+    pageTable[vpn].valid = false;  // The frame now belongs to someone else.
 }
 
 void
 AddressSpace::LoadFromSwap(unsigned vpn, int physPage)
 {
     DEBUG('c', "Buscando %d de swap\n", vpn);
-    int inFileAddr = vpn * PAGE_SIZE;
-    int physAddr = physPage * PAGE_SIZE;
-    swap -> ReadAt(&machine -> mainMemory[physAddr], PAGE_SIZE, inFileAddr);
+    unsigned pageSize = machine -> pageSize;
+    int inFileAddr = vpn * pageSize;
+    int physAddr = physPage * pageSize;
+    swap -> ReadAt(&machine -> mainMemory[physAddr], pageSize, inFileAddr);
+}
+
+/// The swap file is named after the address space, `SWAP.<asid>`.
+void
+AddressSpace::CreateSwap()
+{
+    char swapName[16];
+
+    DEBUG('c', "Inicializando swap\n");
+
+    sprintf(swapName, "SWAP.%d", asid);
+    ASSERT(fileSystem -> Create(swapName, 0));
+    swap = fileSystem -> Open(swapName);
+}
+
+/// Only the name of the executable is saved, not its contents.
+void
+AddressSpace::Save(Snapshot *snapshot)
+{
+    ASSERT(snapshot != NULL);
+
+    unsigned length = strlen(fileName);
+
+    snapshot->Write(&length, sizeof length);
+    snapshot->Write(fileName, length);
+    snapshot->Write(&noffH, sizeof noffH);
+    snapshot->Write(&numPages, sizeof numPages);
+    snapshot->Write(pageTable, numPages * sizeof *pageTable);
+    snapshot->Write(states, numPages * sizeof *states);
+
+    #ifdef VMEM
+    unsigned  pageSize = machine->pageSize;
+    char     *page = new char[pageSize];
+
+    for (unsigned i = 0; i < numPages; i++)
+        if (states[i] == IN_SWAP) {
+            swap->ReadAt(page, pageSize, i * pageSize);
+            snapshot->Write(page, pageSize);
+        }
+    delete [] page;
+    #endif
 }
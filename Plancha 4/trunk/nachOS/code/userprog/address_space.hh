@@ -18,6 +18,10 @@
 #include "machine/translation_entry.hh"
 #include "bin/noff.h"
 
+
+class Snapshot;
+
+
 const unsigned USER_STACK_SIZE = 1024;  ///< Increase this as necessary!
 
 enum States 
@@ -33,7 +37,11 @@ public:
     /// the file `executable`.
     ///
     /// * `executable` is the open file that corresponds to the program.
-    AddressSpace(OpenFile *executable, int pid);
+    /// * `fileName` is the name it was opened by.
+    AddressSpace(OpenFile *executable, const char *fileName, int pid);
+
+    /// Recreate the address space saved in `snapshot` by `Save`.
+    AddressSpace(Snapshot *snapshot, int pid);
 
     /// De-allocate an address space.
     ~AddressSpace();
@@ -49,6 +57,9 @@ public:
     TranslationEntry *GetPT(int page);
     unsigned GetNumPages();
 
+    /// Name of the file the program was loaded from.
+    const char *GetFileName() const;
+
     /// Checks that the vpn is between parameters
     bool VPNControl(unsigned vpn);
 
@@ -57,8 +68,14 @@ public:
 
     void SaveToSwap(unsigned vpn);
     void LoadFromSwap(unsigned vpn, int physPage);
+
+    /// Save the page table, and the pages in swap, to `snapshot`.
+    void Save(Snapshot *snapshot);
 private:
 
+    /// Create and open the swap file of the address space.
+    void CreateSwap();
+
     /// Assume linear page table translation for now!
     TranslationEntry *pageTable;
 
@@ -66,6 +83,7 @@ private:
     unsigned numPages;
 
     OpenFile *executable;
+    char *fileName;  ///< Name `executable` was opened by.
     noffHeader noffH;
 
     States *states;
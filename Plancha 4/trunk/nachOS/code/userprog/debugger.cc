@@ -14,7 +14,7 @@
 static inline void
 PrintPrompt()
 {
-    const char PROMPT[] = "%u> ";
+    const char PROMPT[] = "%llu> ";
 
     printf(PROMPT, stats->totalTicks);
     fflush(stdout);
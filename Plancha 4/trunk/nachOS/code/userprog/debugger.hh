@@ -7,6 +7,7 @@
 
 
 #include "machine/machine.hh"
+#include "machine/statistics.hh"
 
 
 class Debugger : public SingleStepper {
@@ -25,8 +26,8 @@ private:
 
     char buffer[BUFFER_SIZE];
     int previousRegisters[NUM_TOTAL_REGS];
-    unsigned runUntilTime;  ///< Drop back into the debugger when simulated
-                            ///< time reaches this value.
+    Ticks runUntilTime;  ///< Drop back into the debugger when simulated
+                         ///< time reaches this value.
 };
 
 
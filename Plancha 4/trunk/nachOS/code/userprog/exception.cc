@@ -48,54 +48,126 @@
 /// * `which` is the kind of exception.  The list of possible exceptions is
 ///   in `machine.hh`.
 
+#ifdef USE_TLB
+/// Load the translation for the page holding `vaddr` into the TLB, or
+/// finish the current thread if the address lies outside its address space.
+static void
+HandlePageFault(unsigned vaddr)
+{
+    unsigned vpn = vaddr / machine -> pageSize;
+    DEBUG('b', "BAD_VADDR_REG: %i, vpn: %i\n", vaddr, vpn);
+
+    if (!currentThread -> space -> VPNControl(vpn))
+    {
+        DEBUG('b', "Error en vpn: %i\n", vpn);
+        currentThread->Finish(0);
+    }
+    else
+        currentThread -> space -> InsertTLB(vpn); 
+}
+#endif
+
+/// Return where the user byte at `userAddress` lives in `mainMemory`,
+/// bringing its page in first if it is not mapped.
+///
+/// The translation is good up to the end of the page, so callers can copy
+/// a whole page worth of bytes from a single call.
+static char *
+UserToHost(unsigned userAddress, bool writing)
+{
+    unsigned      physicalAddress;
+    ExceptionType exception;
+
+    exception = machine -> Translate(userAddress, &physicalAddress,
+                                     1, writing);
+#ifdef USE_TLB
+    if (exception == PAGE_FAULT_EXCEPTION)
+    {
+        HandlePageFault(userAddress);
+        exception = machine -> Translate(userAddress, &physicalAddress,
+                                         1, writing);
+    }
+#endif
+    ASSERT(exception == NO_EXCEPTION);
+
+    if (writing)  // The page may hold code.
+        machine -> InvalidateDecodedPage(physicalAddress / machine -> pageSize);
+    return &machine -> mainMemory[physicalAddress];
+}
+
+/// Number of bytes from `userAddress` to the end of its page, but no more
+/// than `count`.
+static inline unsigned
+ChunkSize(unsigned userAddress, unsigned count)
+{
+    unsigned left = machine -> pageSize - userAddress % machine -> pageSize;
+    return count < left ? count : left;
+}
+
 /// Funciones que copian datos desde el núcleo al espacio de memoria virtual
-/// del usuario y viceversa
+/// del usuario y viceversa.
+///
+/// Copian de a una página por vez: cada página se traduce una sola vez (y
+/// se trae a memoria si hace falta) y sus bytes se copian con `memcpy`.
 
+/// Copia un string de a lo sumo `maxByteCount` bytes, contando el `'\0'`
+/// final; si no lo encuentra antes, el resultado queda sin terminar.
 void
 ReadStringFromUser(int userAddress, char *outString, unsigned maxByteCount)
 {
-    unsigned i = 0;
-    int c;
-    do {
-        if(!machine -> ReadMem(userAddress + i, 1, &c))
-            ASSERT(machine -> ReadMem(userAddress + i, 1, &c));
-        outString[i++] = (char) c;
-    } while (i < maxByteCount && c != '\0');
+    unsigned address = userAddress;
+
+    while (maxByteCount > 0)
+    {
+        unsigned    chunk = ChunkSize(address, maxByteCount);
+        const char *from = UserToHost(address, false);
+        const char *end = (const char *) memchr(from, '\0', chunk);
+
+        if (end != NULL)
+            chunk = end - from + 1;
+        memcpy(outString, from, chunk);
+        if (end != NULL)
+            return;
+        outString += chunk;
+        address += chunk;
+        maxByteCount -= chunk;
+    }
 }
 
 void
 ReadBufferFromUser(int userAddress, char *outBuffer, unsigned byteCount)
 {
-    int c;
-    for (unsigned i = 0; i < byteCount; i++){
-        if(!machine -> ReadMem(userAddress + i, 1, &c))
-            ASSERT(machine -> ReadMem(userAddress + i, 1, &c));
-        outBuffer[i] = (char) c;
+    unsigned address = userAddress;
+
+    while (byteCount > 0)
+    {
+        unsigned chunk = ChunkSize(address, byteCount);
+        memcpy(outBuffer, UserToHost(address, false), chunk);
+        outBuffer += chunk;
+        address += chunk;
+        byteCount -= chunk;
     }
 }
 
 void
-WriteStringToUser(const char *string, int userAddress)
+WriteBufferToUser(const char *buffer, int userAddress, unsigned byteCount)
 {
-    unsigned i = 0;
-    char c;
-    do {
-        c = string[i];
-        if(!machine -> WriteMem(userAddress + i, 1, c))
-            ASSERT(machine -> WriteMem(userAddress + i, 1, c));
-        i++;
-    } while (c != '\0');
+    unsigned address = userAddress;
+
+    while (byteCount > 0)
+    {
+        unsigned chunk = ChunkSize(address, byteCount);
+        memcpy(UserToHost(address, true), buffer, chunk);
+        buffer += chunk;
+        address += chunk;
+        byteCount -= chunk;
+    }
 }
 
 void
-WriteBufferToUser(const char *buffer, int userAddress, unsigned byteCount)
+WriteStringToUser(const char *string, int userAddress)
 {
-    char c;
-    for (unsigned i = 0; i < byteCount; i++){
-        c = buffer[i];
-        if(!machine -> WriteMem(userAddress + i, 1, c))
-            ASSERT(machine -> WriteMem(userAddress + i, 1, c));
-    }
+    WriteBufferToUser(string, userAddress, strlen(string) + 1);
 }
 
 /// Funcion que actualiza el pc
@@ -159,8 +231,10 @@ HandException(int type)
                 DEBUG('a', "Realizando exec a %s\n", outname);
                 Thread *t = new Thread(strdup(outname), true, 0); 
                 SpaceId spid = AddThread(t); 
-                AddressSpace *space = new AddressSpace(exe, spid);
+                AddressSpace *space = new AddressSpace(exe, outname, spid);
                 t -> space = space;
+                if (profiler != NULL)
+                    profiler -> AddProgram(space, outname);
                 t -> Fork(ProcessCreator, SaveArgs(argv));
                 machine -> WriteRegister(2, GetSpId(t));
             }
@@ -176,12 +250,14 @@ HandException(int type)
             // int Join(SpaceId id);
             SpaceId spid = machine -> ReadRegister(4);
             Thread *t = GetThread(spid);
-            if (t)
+            if (t && t != currentThread && t -> GetJoinFlag())
             { 
                 DEBUG('a', "Realizando join de %s\n", t -> GetName());
+                // Only one `Join` may wait for a thread; later ones fail.
+                RemoveThread(spid);
                 t -> Join();
                 machine -> WriteRegister(2, 0); 
-                RemoveThread(spid);
+                delete t;  // Gives its stack and its other pid back.
             }
             else
             {
@@ -328,17 +404,7 @@ ExceptionHandler(ExceptionType which)
     #ifdef USE_TLB
     else if (which == PAGE_FAULT_EXCEPTION){
         DEBUG('b', "Handling page fault exception\n");
-        int vaddr = machine -> ReadRegister(BAD_VADDR_REG);
-        unsigned vpn = vaddr / PAGE_SIZE;
-        DEBUG('b', "BAD_VADDR_REG: %i, vpn: %i\n", vaddr, vpn);
-
-        if (!currentThread -> space -> VPNControl(vpn))
-        {
-            DEBUG('b', "Error en vpn: %i\n", vpn);
-            currentThread->Finish(0);
-        }
-        else
-            currentThread -> space -> InsertTLB(vpn); 
+        HandlePageFault(machine -> ReadRegister(BAD_VADDR_REG));
     }
     #endif
     else if (which == READ_ONLY_EXCEPTION){
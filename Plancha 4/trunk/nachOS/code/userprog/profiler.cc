@@ -0,0 +1,384 @@
+/// Routines for the sampling profiler of user programs.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "profiler.hh"
+#include "bin/coff.h"
+#include "bin/extern/syms.h"
+#include "threads/system.hh"
+
+#include <stdlib.h>
+
+
+/// Sizes of the symbol table records in a COFF file.  The structures in
+/// `syms.h` declare their fields `long`, so they only match the file on
+/// hosts where that is 32 bits wide; the records are decoded by hand here.
+static const unsigned SYMBOLIC_HEADER_SIZE = 96;  ///< `HDRR`.
+static const unsigned EXTERNAL_SYMBOL_SIZE = 16;  ///< `EXTR`.
+
+/// Word `i` of a record read from a COFF file.
+static inline unsigned
+RecordWord(const char *record, unsigned i)
+{
+    unsigned word;
+    memcpy(&word, record + 4 * i, 4);
+    return WordToHost(word);
+}
+
+/// Dummy function because C++ does not allow pointers to member functions.
+static void
+ProfilerSample(void *arg)
+{
+    ASSERT(arg != NULL);
+
+    ((Profiler *) arg)->Sample();
+}
+
+/// Initialize the profiler, with no program known yet, and start sampling.
+///
+/// * `samplePeriod` is the number of ticks between samples.
+Profiler::Profiler(unsigned samplePeriod)
+{
+    ASSERT(samplePeriod > 0);
+
+    period          = samplePeriod;
+    programCapacity = 4;
+    programs        = new Program *[programCapacity];
+    numPrograms     = 0;
+    bindingCapacity = 4;
+    bindings        = new Binding[bindingCapacity];
+    numBindings     = 0;
+
+    interrupt->SetSampler(ProfilerSample, this, period);
+}
+
+Profiler::~Profiler()
+{
+    for (unsigned i = 0; i < numPrograms; i++) {
+        Program *p = programs[i];
+        for (unsigned j = 0; j < p->numSymbols; j++)
+            delete [] p->symbols[j].name;
+        delete [] p->symbols;
+        delete [] p->unknown.name;
+        delete [] p->name;
+        delete p;
+    }
+    delete [] programs;
+    delete [] bindings;
+}
+
+void
+Profiler::AddProgram(const AddressSpace *space, const char *executable)
+{
+    ASSERT(space != NULL);
+    ASSERT(executable != NULL);
+
+    Program *program = FindProgram(executable);
+
+    // A new address space may have been given the place of a deleted one.
+    for (unsigned i = 0; i < numBindings; i++)
+        if (bindings[i].space == space) {
+            bindings[i].program = program;
+            return;
+        }
+
+    if (numBindings == bindingCapacity) {
+        Binding *bigger = new Binding[2 * bindingCapacity];
+        memcpy(bigger, bindings, numBindings * sizeof *bindings);
+        delete [] bindings;
+        bindings = bigger;
+        bindingCapacity *= 2;
+    }
+    bindings[numBindings].space   = space;
+    bindings[numBindings].program = program;
+    numBindings++;
+}
+
+/// Charge a sample to the function the current thread is executing.
+///
+/// A sample taken while the kernel runs a system call is charged to the
+/// function that made the call.  Samples taken while no user program holds
+/// the CPU are dropped.
+void
+Profiler::Sample()
+{
+    const AddressSpace *space = currentThread->space;
+    Program            *program = NULL;
+
+    if (space == NULL)
+        return;
+    for (unsigned i = 0; i < numBindings; i++)
+        if (bindings[i].space == space) {
+            program = bindings[i].program;
+            break;
+        }
+    if (program == NULL)
+        return;
+
+    Symbol *symbol = Lookup(program, machine->ReadRegister(PC_REG));
+    if (interrupt->GetStatus() == USER_MODE)
+        symbol->userSamples++;
+    else
+        symbol->kernelSamples++;
+    program->samples++;
+}
+
+Profiler::Program *
+Profiler::FindProgram(const char *executable)
+{
+    for (unsigned i = 0; i < numPrograms; i++)
+        if (strcmp(programs[i]->name, executable) == 0)
+            return programs[i];
+
+    Program *program = new Program;
+    program->name = new char [strlen(executable) + 1];
+    strcpy(program->name, executable);
+    program->symbols        = NULL;
+    program->numSymbols     = 0;
+    program->symbolCapacity = 0;
+    program->unknown.address       = 0;
+    program->unknown.name          = new char [sizeof "[unknown]"];
+    strcpy(program->unknown.name, "[unknown]");
+    program->unknown.userSamples   = 0;
+    program->unknown.kernelSamples = 0;
+    program->samples = 0;
+    program->symbolized = LoadSymbols(program);
+    DEBUG('a', "Profiling %s, %u symbols\n",
+          program->name, program->numSymbols);
+
+    if (numPrograms == programCapacity) {
+        Program **bigger = new Program *[2 * programCapacity];
+        memcpy(bigger, programs, numPrograms * sizeof *programs);
+        delete [] programs;
+        programs = bigger;
+        programCapacity *= 2;
+    }
+    programs[numPrograms++] = program;
+    return program;
+}
+
+/// Read the external text symbols (functions and labels) of `program`
+/// from the COFF file it was made from.
+///
+/// Static functions only appear among the local symbols, which are not
+/// read; their samples go to the function linked right before them.
+///
+/// Return false if there is no usable COFF file.
+bool
+Profiler::LoadSymbols(Program *program)
+{
+    ASSERT(program != NULL);
+
+    char *coffName = new char [strlen(program->name) + sizeof ".coff"];
+    strcpy(coffName, program->name);
+    strcat(coffName, ".coff");
+    FILE *f = fopen(coffName, "rb");
+    delete [] coffName;
+    if (f == NULL)
+        return false;
+
+    coffFileHeader fileH;
+    char           header[SYMBOLIC_HEADER_SIZE];
+    bool           ok = false;
+
+    if (fread(&fileH, sizeof fileH, 1, f) == 1
+          && ShortToHost(fileH.magic) == COFF_MIPSELMAGIC
+          && fseek(f, WordToHost(fileH.symbolPtr), SEEK_SET) == 0
+          && fread(header, sizeof header, 1, f) == 1
+          && (short) ShortToHost(*(unsigned short *) header) == magicSym) {
+        // Word 0 holds `magic` and `vstamp`; the rest are the `long`
+        // fields of `HDRR`, in order.
+        unsigned issExtMax     = RecordWord(header, 16);
+        unsigned cbSsExtOffset = RecordWord(header, 17);
+        unsigned iextMax       = RecordWord(header, 22);
+        unsigned cbExtOffset   = RecordWord(header, 23);
+        char    *strings = new char [issExtMax + 1];
+
+        if (fseek(f, cbSsExtOffset, SEEK_SET) == 0
+              && fread(strings, 1, issExtMax, f) == issExtMax
+              && fseek(f, cbExtOffset, SEEK_SET) == 0) {
+            strings[issExtMax] = '\0';
+            ok = true;
+            for (unsigned i = 0; i < iextMax; i++) {
+                char record[EXTERNAL_SYMBOL_SIZE];
+                if (fread(record, sizeof record, 1, f) != 1) {
+                    ok = false;
+                    break;
+                }
+                // Word 0 holds the flags and `ifd`; then comes the `SYMR`.
+                unsigned iss   = RecordWord(record, 1);
+                unsigned value = RecordWord(record, 2);
+                unsigned bits  = RecordWord(record, 3);
+                unsigned st = bits & 0x3F, sc = bits >> 6 & 0x1F;
+                if (sc == scText && iss < issExtMax
+                      && (st == stProc || st == stStaticProc
+                          || st == stGlobal || st == stLabel))
+                    InsertSymbol(program, value, &strings[iss]);
+            }
+        }
+        delete [] strings;
+    }
+    fclose(f);
+
+    if (!ok) {  // Do not keep half a symbol table.
+        for (unsigned i = 0; i < program->numSymbols; i++)
+            delete [] program->symbols[i].name;
+        program->numSymbols = 0;
+    }
+    return program->numSymbols > 0;
+}
+
+Profiler::Symbol *
+Profiler::Lookup(Program *program, unsigned address)
+{
+    ASSERT(program != NULL);
+
+    if (!program->symbolized) {
+        // Every address is a symbol of its own.
+        char name[sizeof "0x00000000"];
+        snprintf(name, sizeof name, "0x%08X", address);
+        return InsertSymbol(program, address, name);
+    }
+
+    // Find the last symbol not after `address`.
+    unsigned low = 0, high = program->numSymbols;
+    while (low < high) {
+        unsigned middle = (low + high) / 2;
+        if (program->symbols[middle].address <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low == 0 ? &program->unknown : &program->symbols[low - 1];
+}
+
+/// If there already is a symbol at `address`, keep it and return it.
+Profiler::Symbol *
+Profiler::InsertSymbol(Program *program, unsigned address, const char *name)
+{
+    ASSERT(program != NULL);
+    ASSERT(name != NULL);
+
+    unsigned low = 0, high = program->numSymbols;
+    while (low < high) {
+        unsigned middle = (low + high) / 2;
+        if (program->symbols[middle].address < address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low < program->numSymbols && program->symbols[low].address == address)
+        return &program->symbols[low];
+
+    if (program->numSymbols == program->symbolCapacity) {
+        unsigned capacity = program->symbolCapacity == 0
+                            ? 64 : 2 * program->symbolCapacity;
+        Symbol  *bigger = new Symbol[capacity];
+        memcpy(bigger, program->symbols,
+               program->numSymbols * sizeof *bigger);
+        delete [] program->symbols;
+        program->symbols = bigger;
+        program->symbolCapacity = capacity;
+    }
+    memmove(&program->symbols[low + 1], &program->symbols[low],
+            (program->numSymbols - low) * sizeof *program->symbols);
+    program->numSymbols++;
+
+    Symbol *symbol = &program->symbols[low];
+    symbol->address = address;
+    symbol->name    = new char [strlen(name) + 1];
+    strcpy(symbol->name, name);
+    symbol->userSamples   = 0;
+    symbol->kernelSamples = 0;
+    return symbol;
+}
+
+int
+Profiler::CompareSamples(const void *a, const void *b)
+{
+    const Symbol      *x = *(const Symbol *const *) a;
+    const Symbol      *y = *(const Symbol *const *) b;
+    unsigned long long totalX = x->userSamples + x->kernelSamples,
+                       totalY = y->userSamples + y->kernelSamples;
+
+    return totalX > totalY ? -1 : totalX < totalY ? 1 : 0;
+}
+
+void
+Profiler::PrintProgram(Program *program)
+{
+    ASSERT(program != NULL);
+
+    const Symbol **order = new const Symbol *[program->numSymbols + 1];
+    unsigned       n = 0;
+
+    for (unsigned i = 0; i <= program->numSymbols; i++) {
+        const Symbol *s = i < program->numSymbols
+                          ? &program->symbols[i] : &program->unknown;
+        if (s->userSamples + s->kernelSamples > 0)
+            order[n++] = s;
+    }
+    qsort(order, n, sizeof *order, CompareSamples);
+
+    printf("Profile of %s: %llu samples, about one every %u ticks%s.\n",
+           program->name, program->samples, period,
+           program->symbolized ? "" : " (no symbols)");
+    printf("%6s %10s %10s  %s\n", "%", "user", "kernel", "function");
+    for (unsigned i = 0; i < n; i++) {
+        const Symbol *s = order[i];
+        printf("%6.2f %10llu %10llu  %s\n",
+               100.0 * (s->userSamples + s->kernelSamples) / program->samples,
+               s->userSamples, s->kernelSamples, s->name);
+    }
+    printf("\n");
+    delete [] order;
+}
+
+/// Write one folded stack, with whatever would confuse flame graph tools
+/// in `name` replaced by underscores.
+static void
+FoldedName(FILE *f, const char *name)
+{
+    for (; *name != '\0'; name++)
+        fputc(*name == ';' || *name == ' ' ? '_' : *name, f);
+}
+
+void
+Profiler::Print()
+{
+    FILE *folded = fopen(PROFILE_FOLDED_FILE, "w");
+
+    if (folded == NULL)
+        printf("Unable to open %s\n", PROFILE_FOLDED_FILE);
+    for (unsigned i = 0; i < numPrograms; i++) {
+        Program *program = programs[i];
+        if (program->samples == 0)
+            continue;
+        PrintProgram(program);
+        if (folded == NULL)
+            continue;
+        for (unsigned j = 0; j <= program->numSymbols; j++) {
+            const Symbol *s = j < program->numSymbols
+                              ? &program->symbols[j] : &program->unknown;
+            if (s->userSamples > 0) {
+                FoldedName(folded, program->name);
+                fputc(';', folded);
+                FoldedName(folded, s->name);
+                fprintf(folded, " %llu\n", s->userSamples);
+            }
+            if (s->kernelSamples > 0) {
+                FoldedName(folded, program->name);
+                fputc(';', folded);
+                FoldedName(folded, s->name);
+                fprintf(folded, ";[kernel] %llu\n", s->kernelSamples);
+            }
+        }
+    }
+    if (folded != NULL) {
+        fclose(folded);
+        printf("Folded stacks written to %s\n\n", PROFILE_FOLDED_FILE);
+    }
+}
@@ -0,0 +1,107 @@
+/// Data structures for a sampling profiler of user programs.
+///
+/// Every so many ticks, the profiler looks at the program counter of the
+/// user program that holds the CPU, and charges the sample to the function
+/// it falls in.  Functions are found in the symbol table of the COFF file
+/// the program was converted from (`<program>.coff`, which the `userland`
+/// makefile leaves next to every program); when there is no such file,
+/// samples are charged to the bare addresses.
+///
+/// When Nachos halts, the profiler prints a flat profile of every program
+/// that ran, and writes the same samples as folded stacks (one
+/// `program;function count` line each) for flame graph tools.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_USERPROG_PROFILER__HH
+#define NACHOS_USERPROG_PROFILER__HH
+
+
+#include "address_space.hh"
+
+
+/// File the folded stacks are written to.
+const char *const PROFILE_FOLDED_FILE = "nachos.folded";
+
+/// Default number of ticks between samples.
+const unsigned DEFAULT_PROFILE_PERIOD = 100;
+
+class Profiler {
+public:
+
+    /// Start taking a sample every `period` ticks.
+    Profiler(unsigned period);
+
+    ~Profiler();
+
+    /// Note that `space` holds the program in the file `executable`, so
+    /// that samples taken while it runs are charged to that program.
+    void AddProgram(const AddressSpace *space, const char *executable);
+
+    /// Charge one sample to the current thread.
+    void Sample();
+
+    /// Print the flat profile and write the folded stacks.
+    void Print();
+
+private:
+
+    /// A function, or a single address when there are no symbols.
+    struct Symbol {
+        unsigned address;
+        char *name;
+        unsigned long long userSamples;    ///< Taken while running it.
+        unsigned long long kernelSamples;  ///< Taken inside a system call
+                                           ///< made from it.
+    };
+
+    /// Every program that ran, however many times, gets one of these.
+    struct Program {
+        char *name;
+        bool symbolized;    ///< Whether `symbols` come from a COFF file.
+        Symbol *symbols;    ///< Sorted by address.
+        unsigned numSymbols;
+        unsigned symbolCapacity;
+        Symbol unknown;     ///< Addresses below the first symbol.
+        unsigned long long samples;
+    };
+
+    /// Which program an address space holds.
+    struct Binding {
+        const AddressSpace *space;
+        Program *program;
+    };
+
+    unsigned period;
+
+    Program **programs;
+    unsigned numPrograms;
+    unsigned programCapacity;
+
+    Binding *bindings;
+    unsigned numBindings;
+    unsigned bindingCapacity;
+
+    /// Return the program called `executable`, loading it if it is new.
+    Program *FindProgram(const char *executable);
+
+    /// Fill the symbol table of `program` from `<name>.coff`.
+    static bool LoadSymbols(Program *program);
+
+    /// Return the symbol `address` belongs to.
+    static Symbol *Lookup(Program *program, unsigned address);
+
+    /// Add a symbol to `program`, keeping `symbols` sorted.
+    static Symbol *InsertSymbol(Program *program, unsigned address,
+                                const char *name);
+
+    /// For `qsort`: order symbols by decreasing number of samples.
+    static int CompareSamples(const void *a, const void *b);
+
+    void PrintProgram(Program *program);
+};
+
+
+#endif
@@ -30,8 +30,11 @@ StartProcess(const char *filename)
         printf("Unable to open file %s\n", filename);
         return;
     }
-    space = new AddressSpace(executable, AddThread(currentThread));
+    space = new AddressSpace(executable, filename,
+                             AddThread(currentThread));
     currentThread->space = space;
+    if (profiler != NULL)
+        profiler->AddProgram(space, filename);
 
     #ifndef USE_DL
     delete executable;
@@ -0,0 +1,95 @@
+/// Performance test for scheduling policies.
+///
+/// Runs several user programs at once, say some that compute and some that
+/// write to the console, and waits for all of them.  Then reports the share
+/// of the CPU every program got, and its turnaround: how long it took from
+/// the start of the test until it exited.  Run it with each `-sched` policy
+/// to compare how fair they are, and how they treat I/O against computing.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "address_space.hh"
+#include "threads/system.hh"
+
+
+/// Body of every program thread: jump to the user program.
+///
+/// * `dummy` is because every forked procedure takes one argument.
+static void
+RunProgram(void *dummy)
+{
+    currentThread->space->InitRegisters();
+    currentThread->space->RestoreState();
+    machine->Run();
+}
+
+/// Run the `count` user programs named in `programs` at once, as `Exec`
+/// does, and report how they were scheduled.  The programs must end with
+/// `Exit`, not `Halt`.
+void
+SchedulingPerformanceTest(char **programs, unsigned count)
+{
+    ASSERT(programs != NULL);
+
+    printf("Scheduling performance test: %u programs at once.\n", count);
+
+    Thread **threads = new Thread *[count];
+    Ticks   startTicks = stats->totalTicks;
+
+    for (unsigned i = 0; i < count; i++) {
+        threads[i] = NULL;
+
+        OpenFile *executable = fileSystem->Open(programs[i]);
+        if (executable == NULL) {
+            printf("Unable to open file %s\n", programs[i]);
+            continue;
+        }
+
+        Thread *t = new Thread(programs[i], true, 0);
+        t->space = new AddressSpace(executable, programs[i], AddThread(t));
+        if (profiler != NULL)
+            profiler->AddProgram(t->space, programs[i]);
+        #ifndef USE_DL
+        delete executable;
+        #endif
+
+        t->Fork(RunProgram, NULL);
+        threads[i] = t;
+    }
+
+    // Every thread records when it finished, so they can be joined in any
+    // order.
+    Ticks busyTicks = 0, lastTicks = startTicks, sumTurnaround = 0;
+    unsigned finished = 0;
+    for (unsigned i = 0; i < count; i++) {
+        if (threads[i] == NULL)
+            continue;
+        threads[i]->Join();
+        busyTicks += threads[i]->runTicks;
+        if (threads[i]->finishTicks > lastTicks)
+            lastTicks = threads[i]->finishTicks;
+        sumTurnaround += threads[i]->finishTicks - startTicks;
+        finished++;
+    }
+
+    printf("%-24s %12s %7s %12s\n", "Program", "Ticks run", "Share",
+           "Turnaround");
+    for (unsigned i = 0; i < count; i++) {
+        if (threads[i] == NULL)
+            continue;
+        printf("%-24s %12llu %6.1f%% %12llu\n", programs[i],
+               threads[i]->runTicks,
+               busyTicks > 0 ? 100.0 * threads[i]->runTicks / busyTicks
+                             : 0.0,
+               threads[i]->finishTicks - startTicks);
+        delete threads[i];
+    }
+    printf("Ran %u programs in %llu ticks (mean turnaround %llu ticks).\n",
+           finished, lastTicks - startTicks,
+           finished > 0 ? sumTurnaround / finished : 0);
+
+    delete [] threads;
+}
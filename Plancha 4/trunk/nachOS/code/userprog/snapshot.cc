@@ -0,0 +1,216 @@
+/// Routines to save the simulated machine to a host file, and to start
+/// again from it.
+///
+/// A snapshot is tied to the kernel that wrote it: it is a plain dump of
+/// the data structures involved, in host byte order, after a header that
+/// tells kernels with a different layout apart.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "snapshot.hh"
+#include "threads/system.hh"
+
+
+/// First bytes of every snapshot file.
+static const char SNAPSHOT_MAGIC[8] = "NACHSN2";
+
+/// What must match between the kernel that wrote a snapshot and the one
+/// reading it.
+struct SnapshotLayout {
+    unsigned memorySize;
+    unsigned pageSize;
+    unsigned tlbSize;  ///< 0 if there is no TLB.
+    unsigned numRegisters;
+    unsigned statisticsSize;
+    unsigned withDisk;
+};
+
+static void
+GetLayout(SnapshotLayout *layout)
+{
+    ASSERT(layout != NULL);
+
+    memset(layout, 0, sizeof *layout);
+    layout->memorySize     = machine->memorySize;
+    layout->pageSize       = machine->pageSize;
+    layout->tlbSize        = machine->tlb != NULL ? TLB_SIZE : 0;
+    layout->numRegisters   = NUM_TOTAL_REGS;
+    layout->statisticsSize = sizeof (Statistics);
+#ifdef FILESYS
+    layout->withDisk       = 1;
+#endif
+}
+
+Snapshot::Snapshot(FILE *f)
+{
+    ASSERT(f != NULL);
+    file = f;
+}
+
+void
+Snapshot::Write(const void *data, unsigned size)
+{
+    ASSERT(data != NULL);
+
+    size_t written = fwrite(data, 1, size, file);
+    ASSERT(written == size);
+}
+
+void
+Snapshot::Read(void *data, unsigned size)
+{
+    ASSERT(data != NULL);
+
+    size_t got = fread(data, 1, size, file);
+    ASSERT(got == size);  // A truncated snapshot.
+}
+
+/// Return true if the current thread runs the only user process, and was
+/// interrupted in user mode, with no I/O in progress.
+static bool
+CanTakeSnapshot()
+{
+    if (currentThread->space == NULL
+          || interrupt->GetInterruptedStatus() != USER_MODE)
+        return false;
+    for (unsigned i = 0; i < MAX_PID_THREADS; i++)
+        if (threadsPid[i] != NULL && threadsPid[i] != currentThread)
+            return false;
+    for (OpenFileId id = 2; id < NUM_MAX_FILES; id++)
+        if (currentThread->GetFile(id) != NULL)
+            return false;
+    return !interrupt->IsPending(DISK_INT)
+           && !interrupt->IsPending(CONSOLE_WRITE_INT)
+           && !interrupt->IsPending(CONSOLE_READ_INT)
+           && !interrupt->IsPending(NETWORK_SEND_INT)
+           && !interrupt->IsPending(NETWORK_RECV_INT);
+}
+
+/// Meant to be called from the timer interrupt handler, which may then have
+/// the process yield, as the scheduling policy decides: `ResumeSnapshot`
+/// yields too in that case, before going back to user code, so that a
+/// resumed run goes on exactly like the original.
+bool
+TakeSnapshot(const char *fileName, bool yielding)
+{
+    ASSERT(fileName != NULL);
+
+    if (!CanTakeSnapshot())
+        return false;
+
+    FILE *file = fopen(fileName, "wb");
+    if (file == NULL) {
+        printf("Unable to open file %s\n", fileName);
+        return true;  // Trying again would not help.
+    }
+
+    Snapshot       snapshot(file);
+    SnapshotLayout layout;
+    SpaceId        pid = GetSpId(currentThread);
+
+    GetLayout(&layout);
+    snapshot.Write(SNAPSHOT_MAGIC, sizeof SNAPSHOT_MAGIC);
+    snapshot.Write(&layout, sizeof layout);
+
+    machine->UpdateStatistics();
+    snapshot.Write(stats, sizeof *stats);
+    interrupt->Save(&snapshot);
+
+    snapshot.Write(&pid, sizeof pid);
+    snapshot.Write(&yielding, sizeof yielding);
+    currentThread->space->Save(&snapshot);
+#ifdef VMEM
+    coreMap->Save(&snapshot, currentThread->space);
+#endif
+    for (unsigned i = 0; i < machine->numPhysPages; i++) {
+        bool used = bitMap->Test(i);
+        snapshot.Write(&used, sizeof used);
+    }
+#ifdef FILESYS
+    synchDisk->Save(&snapshot);
+#endif
+    machine->Save(&snapshot);
+    fclose(file);
+
+    printf("Snapshot written to %s at tick %llu\n",
+           fileName, stats->totalTicks);
+    return true;
+}
+
+/// Must be called before any process is started, in place of
+/// `StartProcess`.
+void
+ResumeSnapshot(const char *fileName)
+{
+    ASSERT(fileName != NULL);
+
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL) {
+        printf("Unable to open file %s\n", fileName);
+        return;
+    }
+
+    Snapshot       snapshot(file);
+    char           magic[sizeof SNAPSHOT_MAGIC];
+    SnapshotLayout layout, ours;
+
+    GetLayout(&ours);
+    if (fread(magic, sizeof magic, 1, file) != 1
+          || memcmp(magic, SNAPSHOT_MAGIC, sizeof magic) != 0
+          || fread(&layout, sizeof layout, 1, file) != 1
+          || memcmp(&layout, &ours, sizeof layout) != 0) {
+        printf("%s is not a snapshot taken by this kernel\n", fileName);
+        fclose(file);
+        return;
+    }
+
+    // Time first: interrupts are restored relative to it.  The saved
+    // interrupts include the timer, which dynamic ticks may have stopped.
+    timer->Start();
+    const char *jsonFile = stats->jsonFile;
+    snapshot.Read(stats, sizeof *stats);
+    stats->jsonFile = jsonFile;
+    interrupt->Restore(&snapshot);
+
+    SpaceId pid;
+    bool    yielding;
+    snapshot.Read(&pid, sizeof pid);
+    snapshot.Read(&yielding, sizeof yielding);
+    ASSERT(pid >= 0 && pid < MAX_PID_THREADS && threadsPid[pid] == NULL);
+    threadsPid[pid] = currentThread;
+    AddressSpace *space = new AddressSpace(&snapshot, pid);
+    currentThread->space = space;
+    if (profiler != NULL)
+        profiler->AddProgram(space, space->GetFileName());
+#ifdef VMEM
+    coreMap->Restore(&snapshot, space);
+#endif
+    for (unsigned i = 0; i < machine->numPhysPages; i++) {
+        bool used;
+        snapshot.Read(&used, sizeof used);
+        if (used)
+            bitMap->Mark(i);
+        else
+            bitMap->Clear(i);
+    }
+#ifdef FILESYS
+    synchDisk->Restore(&snapshot);
+#endif
+
+    // Load the page table register before the TLB comes back, since it
+    // flushes the TLB.
+    space->RestoreState();
+    machine->Restore(&snapshot);
+    fclose(file);
+
+    DEBUG('a', "Resuming %s at tick %llu\n",
+          space->GetFileName(), stats->totalTicks);
+    scheduler->UpdateTimer();
+    if (yielding)
+        currentThread->Yield();
+    machine->Run();
+    ASSERT(false);  // `machine->Run` never returns.
+}
@@ -0,0 +1,63 @@
+/// Snapshots of the simulated machine, for starting benchmarks warm.
+///
+/// A snapshot holds everything needed to carry on running a user program
+/// from the point it was taken: simulated time and statistics, the pending
+/// interrupts, the registers, TLB and physical memory of the machine, the
+/// address space of the program with its swap, the core map and, with a
+/// real file system, the disk image.
+///
+/// Kernel threads cannot be saved, since their state lives in host stacks.
+/// So a snapshot can only be taken while a single user process exists, and
+/// it is running user code; that is, from the timer interrupt.  Files the
+/// process had open are not saved either, and neither is the state of the
+/// host random number generator.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_USERPROG_SNAPSHOT__HH
+#define NACHOS_USERPROG_SNAPSHOT__HH
+
+
+#include <stdio.h>
+
+
+/// A snapshot file, open for writing or for reading.
+///
+/// The parts of the system save and restore themselves through it (see the
+/// `Save` and `Restore` methods of `Machine`, `Interrupt`, `AddressSpace`,
+/// `CoreMap` and `Disk`), always in the same order.
+class Snapshot {
+public:
+
+    /// Start writing or reading `file`, which must be open in the right
+    /// mode.
+    Snapshot(FILE *file);
+
+    /// Append `size` bytes at `data`.
+    void Write(const void *data, unsigned size);
+
+    /// Read the next `size` bytes into `data`.
+    void Read(void *data, unsigned size);
+
+private:
+    FILE *file;
+};
+
+/// Write a snapshot of the running user program to `fileName`.
+///
+/// `yielding` tells whether the program is about to yield, as it will then
+/// when resumed.
+///
+/// Return false, without writing anything, if the system is not in a state
+/// that can be saved.
+bool TakeSnapshot(const char *fileName, bool yielding);
+
+/// Restore the snapshot in `fileName`, and jump back into the user program.
+///
+/// Only returns if the snapshot cannot be read.
+void ResumeSnapshot(const char *fileName);
+
+
+#endif
@@ -1,4 +1,5 @@
 #include "synch_console.hh"
+#include "threads/system.hh"
 
 static void
 ConsoleWriteDone(void *arg)
@@ -55,6 +56,7 @@ SynchConsole::SynchPutChar(char ch)
 {
     writelock -> Acquire();  // Solo una escritura a la vez
     console -> PutChar(ch); // Escribo en consola
+    scheduler -> WaitingForIO();
     writesem -> P();        // Espero la interrupcion
     writelock -> Release(); // Libero el lock
 }
@@ -63,6 +65,7 @@ char
 SynchConsole::SynchGetChar()
 {
     readlock -> Acquire();           // Solo una lectura a la vez
+    scheduler -> WaitingForIO();
     readsem -> P();                 // Espero la interrupcion
     char ch = console -> GetChar(); // Leo desde consola
     readlock -> Release();          // Libero el lock
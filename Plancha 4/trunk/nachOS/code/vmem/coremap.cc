@@ -1,9 +1,13 @@
 #include "coremap.hh"
 #include "threads/system.hh"
+#include "userprog/snapshot.hh"
 
-CoreMap::CoreMap() 
+CoreMap::CoreMap(unsigned numPages)
 {
-    for (unsigned i = 0; i < NUM_PHYS_PAGES; i++)
+    numFrames = numPages;
+    owner = new AddressSpace *[numFrames];
+    vpns = new int[numFrames];
+    for (unsigned i = 0; i < numFrames; i++)
     {
         owner[i] = NULL;
         vpns[i] = -1;
@@ -13,13 +17,16 @@ CoreMap::CoreMap()
 }
 
 CoreMap::~CoreMap()
-{}
+{
+    delete [] owner;
+    delete [] vpns;
+}
 
 int
 CoreMap::SelectVictim() 
 {
     int vctm = victim;
-    victim = (victim + 1) % NUM_PHYS_PAGES; 
+    victim = (victim + 1) % numFrames;
     return vctm;
 }
 
@@ -31,21 +38,18 @@ CoreMap::Find(AddressSpace *o, unsigned vpn)
     if (free == -1)
     {
         vctm = SelectVictim();
-        ASSERT(0 <= vctm && vctm < NUM_PHYS_PAGES);
-        Thread *t = GetThread(vpns[vctm]);
-        if (t)
-        {
-            DEBUG('c', "Llevando victima %d con vpn %d a swap\n", vctm, vpns[vctm]);
-            t -> space -> SaveToSwap(vpns[vctm]);
-            //owner[vctm] -> SaveToSwap(vpns[vctm]); TODO: dejar la linea de arriba o esta?
-            free = vctm;
-        }
+        ASSERT(0 <= vctm && vctm < numFrames);
+        ASSERT(owner[vctm] != NULL);
+        DEBUG('c', "Llevando victima %d con vpn %d a swap\n", vctm, vpns[vctm]);
+        owner[vctm] -> SaveToSwap(vpns[vctm]);
+        free = vctm;
     }
     else
         DEBUG('c', "Buscando paginas sin llevar a swap\n");
 
     owner[free] = o;
     vpns[free] = vpn;
+    machine -> InvalidateDecodedPage(free);
 
     DEBUG('c', "Pagina elegida: %d\n", free);
 
@@ -55,7 +59,29 @@ CoreMap::Find(AddressSpace *o, unsigned vpn)
 void
 CoreMap::Clear(unsigned which)
 {
-    ASSERT(0 <= which && which < NUM_PHYS_PAGES);
+    ASSERT(0 <= which && which < numFrames);
     owner[which] = NULL;
     vpns[which] = -1;
 }
+
+void
+CoreMap::Save(Snapshot *snapshot, const AddressSpace *space) const
+{
+    ASSERT(snapshot != NULL);
+
+    for (unsigned i = 0; i < numFrames; i++)
+        ASSERT(owner[i] == NULL || owner[i] == space);
+    snapshot->Write(vpns, numFrames * sizeof *vpns);
+    snapshot->Write(&victim, sizeof victim);
+}
+
+void
+CoreMap::Restore(Snapshot *snapshot, AddressSpace *space)
+{
+    ASSERT(snapshot != NULL);
+
+    snapshot->Read(vpns, numFrames * sizeof *vpns);
+    snapshot->Read(&victim, sizeof victim);
+    for (unsigned i = 0; i < numFrames; i++)
+        owner[i] = vpns[i] == -1 ? NULL : space;
+}
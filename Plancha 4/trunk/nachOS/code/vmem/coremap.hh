@@ -8,16 +8,25 @@
 
 class CoreMap {
 public:
-    CoreMap();
+    /// Keep track of `numPages` physical pages.
+    CoreMap(unsigned numPages);
     ~CoreMap();
 
     int SelectVictim();
     int Find (AddressSpace *o, unsigned vpn);
     void Clear(unsigned which);
 
+    /// Save which page each frame holds to `snapshot`; every frame in use
+    /// must belong to `space`.
+    void Save(Snapshot *snapshot, const AddressSpace *space) const;
+
+    /// Load what `Save` wrote, giving the frames in use to `space`.
+    void Restore(Snapshot *snapshot, AddressSpace *space);
+
 private:
-    AddressSpace *owner[NUM_PHYS_PAGES];
-    int vpns[NUM_PHYS_PAGES];
+    unsigned numFrames;
+    AddressSpace **owner;
+    int *vpns;
     int victim;
 };
 